@@ -0,0 +1,217 @@
+#include <CDiffBench.h>
+#include <CFile.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <climits>
+#include <sys/resource.h>
+
+CDiffBench::
+CDiffBench()
+{
+}
+
+bool
+CDiffBench::
+load(const std::string &lfile, const std::string &rfile)
+{
+  if (! lines_.load(lfile, rfile)) {
+    std::cerr << lines_.errorMsg() << std::endl;
+    return false;
+  }
+
+  std::cout << lfile << ": " << lines_.numLines(CSIDE_TYPE_LEFT ) << " lines, " <<
+               rfile << ": " << lines_.numLines(CSIDE_TYPE_RIGHT) << " lines, " <<
+               lines_.lineTable().size() << " distinct" << std::endl;
+
+  return true;
+}
+
+void
+CDiffBench::
+execLoad(int maxThreads)
+{
+  using Clock = std::chrono::steady_clock;
+
+  auto elapsed = [](const Clock::time_point &start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  };
+
+  std::cout << std::setw(10) << "load" << std::setw(8) << "threads" <<
+               std::setw(12) << "time (s)" << std::setw(10) << "MB/s" <<
+               std::setw(10) << "lines" << std::endl;
+
+  for (auto side : { CSIDE_TYPE_LEFT, CSIDE_TYPE_RIGHT }) {
+    const auto &fileName = lines_.fileName(side);
+
+    double mb = lines_.file(side).size()/(1024.0*1024.0);
+
+    auto print = [&](const char *name, int nt, double t, int numLines) {
+      std::cout << std::setw(10) << name << std::setw(8) << nt <<
+                   std::setw(12) << std::fixed << std::setprecision(3) << t <<
+                   std::setw(10) << std::setprecision(1) << (t > 0.0 ? mb/t : 0.0) <<
+                   std::setw(10) << numLines << std::endl;
+    };
+
+    // read into string per line
+    {
+      auto start = Clock::now();
+
+      std::vector<std::string> lines;
+
+      CFile file(fileName);
+
+      file.toLines(lines);
+
+      print("toLines", 1, elapsed(start), int(lines.size()));
+    }
+
+    // map and build line index (newlines and hashes)
+    for (int nt = 1; ; nt = std::min(2*nt, maxThreads)) {
+      auto start = Clock::now();
+
+      CDiffFile file;
+
+      file.open(fileName, nt);
+
+      print("index", nt, elapsed(start), file.numLines());
+
+      if (nt >= maxThreads)
+        break;
+    }
+  }
+}
+
+void
+CDiffBench::
+execThreads(int maxThreads)
+{
+  struct AlgorithmName {
+    CDiffEngine::Algorithm algorithm;
+    const char            *name;
+  };
+
+  AlgorithmName algorithms[] = {
+    { CDiffEngine::Algorithm::MYERS    , "myers"     },
+    { CDiffEngine::Algorithm::PATIENCE , "patience"  },
+    { CDiffEngine::Algorithm::HISTOGRAM, "histogram" },
+  };
+
+  std::cout << std::setw(10) << "algorithm" << std::setw(8) << "threads" <<
+               std::setw(12) << "time (s)" << std::setw(10) << "speedup" <<
+               std::setw(12) << "peak (MB)" << std::setw(10) << "hunks" << std::endl;
+
+  for (const auto &algorithm : algorithms) {
+    double t1 = 0.0;
+
+    for (int nt = 1; ; nt = std::min(2*nt, maxThreads)) {
+      auto result = execEngine(algorithm.algorithm, nt, CDiffEngine().linearSpaceLines());
+
+      double t = result.time;
+
+      if (nt == 1)
+        t1 = t;
+
+      std::cout << std::setw(10) << algorithm.name << std::setw(8) << nt <<
+                   std::setw(12) << std::fixed << std::setprecision(3) << t <<
+                   std::setw(10) << std::setprecision(2) << (t > 0.0 ? t1/t : 0.0) <<
+                   std::setw(12) << std::setprecision(1) << result.peakKB/1024.0 <<
+                   std::setw(10) << result.numHunks << std::endl;
+
+      if (nt >= maxThreads)
+        break;
+    }
+  }
+}
+
+void
+CDiffBench::
+execLinearSpace()
+{
+  uint defThreshold = CDiffEngine().linearSpaceLines();
+
+  uint thresholds[] = { 0, defThreshold/10, defThreshold, 10*defThreshold, UINT_MAX };
+
+  // ranges above threshold still switch to linear space when the trace exceeds this
+  std::cout << "trace limit " << CDiffEngine().maxTraceBytes()/(1024*1024) << " MB" <<
+               std::endl;
+
+  std::cout << std::setw(12) << "linear >=" << std::setw(12) << "time (s)" <<
+               std::setw(12) << "peak (MB)" << std::setw(10) << "hunks" << std::endl;
+
+  for (const auto &threshold : thresholds) {
+    auto result = execEngine(CDiffEngine::Algorithm::MYERS, 1, threshold);
+
+    std::cout << std::setw(12) << (threshold == UINT_MAX ? std::string("never") :
+                                   std::to_string(threshold)) <<
+                 std::setw(12) << std::fixed << std::setprecision(3) << result.time <<
+                 std::setw(12) << std::setprecision(1) << result.peakKB/1024.0 <<
+                 std::setw(10) << result.numHunks << std::endl;
+  }
+}
+
+CDiffBench::Result
+CDiffBench::
+execEngine(CDiffEngine::Algorithm algorithm, int numThreads, uint linearSpaceLines)
+{
+  CDiffEngine engine;
+
+  engine.setAlgorithm       (algorithm);
+  engine.setLineTable       (&lines_.lineTable());
+  engine.setNumThreads      (numThreads);
+  engine.setLinearSpaceLines(linearSpaceLines);
+
+  CDiffEngine::Hunks hunks;
+
+  resetPeakRSS();
+
+  auto start = std::chrono::steady_clock::now();
+
+  engine.exec(lines_.ids(CSIDE_TYPE_LEFT), lines_.ids(CSIDE_TYPE_RIGHT), hunks);
+
+  auto end = std::chrono::steady_clock::now();
+
+  Result result;
+
+  result.time     = std::chrono::duration<double>(end - start).count();
+  result.peakKB   = peakRSS();
+  result.numHunks = hunks.size();
+
+  return result;
+}
+
+// reset peak resident set size to current (linux only)
+void
+CDiffBench::
+resetPeakRSS()
+{
+  std::ofstream os("/proc/self/clear_refs");
+
+  if (os)
+    os << "5" << std::endl;
+}
+
+// peak resident set size in KB since last reset
+long
+CDiffBench::
+peakRSS()
+{
+  std::ifstream is("/proc/self/status");
+
+  std::string line;
+
+  while (std::getline(is, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0)
+      return std::stol(line.substr(6));
+  }
+
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+    return usage.ru_maxrss;
+
+  return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef CDiffBench_H
+#define CDiffBench_H
+
+#include <CDiffEngine.h>
+#include <CDiffLines.h>
+#include <string>
+
+// Command line timing of the diff engine (CQDiff -bench <file1> <file2>)
+class CDiffBench {
+ public:
+  CDiffBench();
+
+  bool load(const std::string &lfile, const std::string &rfile);
+
+  // time line loading (CFile::toLines) against line indexing for 1 ... maxThreads threads
+  void execLoad(int maxThreads);
+
+  // time each algorithm for 1, 2, 4 ... maxThreads threads
+  void execThreads(int maxThreads);
+
+  // time and peak memory of myers diff for different linear space thresholds
+  void execLinearSpace();
+
+ private:
+  struct Result {
+    double time     { 0.0 };
+    long   peakKB   { 0 };
+    size_t numHunks { 0 };
+  };
+
+  Result execEngine(CDiffEngine::Algorithm algorithm, int numThreads, uint linearSpaceLines);
+
+  static void resetPeakRSS();
+  static long peakRSS();
+
+ private:
+  CDiffLines lines_;
+};
+
+#endif
@@ -0,0 +1,131 @@
+#include <CDiffChanges.h>
+
+#include <algorithm>
+
+CDiffChanges::
+CDiffChanges()
+{
+}
+
+void
+CDiffChanges::
+clear()
+{
+  types_ .clear();
+  lfirst_.clear();
+  llen_  .clear();
+  rfirst_.clear();
+  rlen_  .clear();
+}
+
+void
+CDiffChanges::
+reserve(size_t n)
+{
+  types_ .reserve(n);
+  lfirst_.reserve(n);
+  llen_  .reserve(n);
+  rfirst_.reserve(n);
+  rlen_  .reserve(n);
+}
+
+void
+CDiffChanges::
+add(char c, int lstart, int lend, int rstart, int rend)
+{
+  types_.push_back(c);
+
+  // 'a' has no left lines and inserts after lstart, 'd' has no right lines and
+  // deletes after rstart
+  if (c == 'a') { lfirst_.push_back(lstart); llen_.push_back(0); }
+  else          { lfirst_.push_back(lstart - 1); llen_.push_back(lend - lstart + 1); }
+
+  if (c == 'd') { rfirst_.push_back(rstart); rlen_.push_back(0); }
+  else          { rfirst_.push_back(rstart - 1); rlen_.push_back(rend - rstart + 1); }
+}
+
+std::string
+CDiffChanges::
+header(int i) const
+{
+  return header(type(i), start(CSIDE_TYPE_LEFT , i), end(CSIDE_TYPE_LEFT , i),
+                         start(CSIDE_TYPE_RIGHT, i), end(CSIDE_TYPE_RIGHT, i));
+}
+
+std::string
+CDiffChanges::
+header(char c, int lstart, int lend, int rstart, int rend)
+{
+  auto rangeStr = [](int start, int end) {
+    if (start == end)
+      return std::to_string(start);
+    else
+      return std::to_string(start) + "," + std::to_string(end);
+  };
+
+  return rangeStr(lstart, lend) + c + rangeStr(rstart, rend);
+}
+
+int
+CDiffChanges::
+lineChange(CSideType side, int line) const
+{
+  const auto &firsts = (side == CSIDE_TYPE_LEFT ? lfirst_ : rfirst_);
+
+  auto p = std::upper_bound(firsts.begin(), firsts.end(), line);
+
+  return int(p - firsts.begin()) - 1;
+}
+
+CDiffChanges::Region
+CDiffChanges::
+changedRegion(int lnum, int rnum, int lpre, int lsuf, int rpre, int rsuf) const
+{
+  int n = size();
+
+  // aligned lines k are the lines between changes k - 1 and k
+  auto alignedStart = [&](CSideType side, int k) {
+    return (k > 0 ? first(side, k - 1) + len(side, k - 1) : 0);
+  };
+
+  auto alignedEnd = [&](CSideType side, int k) {
+    return (k < n ? first(side, k) : (side == CSIDE_TYPE_LEFT ? lnum : rnum));
+  };
+
+  Region region;
+
+  // last aligned lines at or before start of changed lines
+  for (int k = 0; k <= n; ++k) {
+    int l1 = alignedStart(CSIDE_TYPE_LEFT , k);
+    int r1 = alignedStart(CSIDE_TYPE_RIGHT, k);
+
+    if (l1 > lpre || r1 > rpre)
+      break;
+
+    int d = std::min({alignedEnd(CSIDE_TYPE_LEFT, k) - l1, lpre - l1, rpre - r1});
+
+    region.change1 = k;
+    region.lstart  = l1 + d;
+    region.rstart  = r1 + d;
+  }
+
+  // first aligned lines at or after end of changed lines
+  int lmin = lnum - lsuf;
+  int rmin = rnum - rsuf;
+
+  for (int k = n; k >= 0; --k) {
+    int l2 = alignedEnd(CSIDE_TYPE_LEFT , k);
+    int r2 = alignedEnd(CSIDE_TYPE_RIGHT, k);
+
+    if (l2 < lmin || r2 < rmin)
+      break;
+
+    int d = std::min({l2 - alignedStart(CSIDE_TYPE_LEFT, k), l2 - lmin, r2 - rmin});
+
+    region.change2 = k;
+    region.lend    = l2 - d;
+    region.rend    = r2 - d;
+  }
+
+  return region;
+}
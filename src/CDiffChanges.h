@@ -0,0 +1,87 @@
+#ifndef CDiffChanges_H
+#define CDiffChanges_H
+
+#include <CSideType.h>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Table of changes (hunks) in line order stored as one array per field (17 bytes per
+// change). Lines of each side are the 0-based first line and line count (a side with
+// no lines has the insert position as first line). Diff normal format ranges and
+// header text are generated when needed.
+class CDiffChanges {
+ public:
+  // changes [change1, change2) and the lines they are aligned between, [lstart, lend)
+  // and [rstart, rend) (0-based), which need to be diffed again when lines change
+  struct Region {
+    int change1 { 0 };
+    int change2 { 0 };
+    int lstart  { 0 };
+    int lend    { 0 };
+    int rstart  { 0 };
+    int rend    { 0 };
+  };
+
+ public:
+  CDiffChanges();
+
+  void clear();
+
+  void reserve(size_t n);
+
+  // add change (diff normal format 1-based ranges) after previously added changes
+  void add(char c, int lstart, int lend, int rstart, int rend);
+
+  int size() const { return int(types_.size()); }
+
+  bool empty() const { return types_.empty(); }
+
+  // change type ('a', 'c' or 'd')
+  char type(int i) const { return types_[size_t(i)]; }
+
+  int first(CSideType side, int i) const {
+    return (side == CSIDE_TYPE_LEFT ? lfirst_ : rfirst_)[size_t(i)];
+  }
+
+  int len(CSideType side, int i) const {
+    return (side == CSIDE_TYPE_LEFT ? llen_ : rlen_)[size_t(i)];
+  }
+
+  // diff normal format range (1-based, start is line before insert if no lines)
+  int start(CSideType side, int i) const {
+    return (len(side, i) > 0 ? first(side, i) + 1 : first(side, i));
+  }
+
+  int end(CSideType side, int i) const {
+    return (len(side, i) > 0 ? first(side, i) + len(side, i) : first(side, i));
+  }
+
+  // diff normal format header (e.g. 10,12c11,13)
+  std::string header(int i) const;
+
+  static std::string header(char c, int lstart, int lend, int rstart, int rend);
+
+  // index of last change starting at or before line (-1 if none)
+  int lineChange(CSideType side, int line) const;
+
+  // region to diff again when files of lnum and rnum lines change except for the first
+  // lpre (rpre) and last lsuf (rsuf) lines. The region is bounded by the nearest aligned
+  // (unchanged) lines outside the changed lines.
+  Region changedRegion(int lnum, int rnum, int lpre, int lsuf, int rpre, int rsuf) const;
+
+  // bytes used per change
+  static size_t changeBytes() { return sizeof(char) + 4*sizeof(int); }
+
+ private:
+  using Types = std::vector<char>;
+  using Ints  = std::vector<int>;
+
+  Types types_;
+  Ints  lfirst_;
+  Ints  llen_;
+  Ints  rfirst_;
+  Ints  rlen_;
+};
+
+#endif
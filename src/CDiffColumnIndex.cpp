@@ -0,0 +1,109 @@
+#include <CDiffColumnIndex.h>
+#include <CDiffFile.h>
+#include <algorithm>
+
+CDiffColumnIndex::
+CDiffColumnIndex(const std::string_view &str)
+{
+  size_t len = str.size();
+
+  for (size_t i = 0; i < len; ++i) {
+    auto c = static_cast<unsigned char>(str[i]);
+
+    if (c >= 0x80 || c == '\t') {
+      simple_ = false;
+      break;
+    }
+  }
+
+  if (simple_)
+    return;
+
+  //---
+
+  marks_.reserve(len/step() + 1);
+
+  int    col     = 0;
+  size_t pos     = 0;
+  size_t nextPos = 0;
+
+  while (pos < len) {
+    if (pos >= nextPos) {
+      marks_.push_back(Mark{pos, col});
+
+      nextPos = pos + step();
+    }
+
+    auto c = static_cast<unsigned char>(str[pos]);
+
+    if (c < 0x80) {
+      ++pos;
+
+      if (c == '\t')
+        col = (col/CDiffFile::tabWidth() + 1)*CDiffFile::tabWidth();
+      else
+        ++col;
+    }
+    else
+      col += CDiffFile::charColumns(CDiffFile::decodeChar(str, pos));
+  }
+}
+
+size_t
+CDiffColumnIndex::
+findColumn(const std::string_view &str, int col, int &startCol) const
+{
+  if (simple_) {
+    size_t pos = std::min(size_t(std::max(col, 0)), str.size());
+
+    startCol = int(pos);
+
+    return pos;
+  }
+
+  // last mark at or before column
+  auto p = std::upper_bound(marks_.begin(), marks_.end(), col,
+             [](int c, const Mark &m) { return c < m.col; });
+
+  if (p == marks_.begin())
+    return scanColumn(str, 0, 0, col, startCol);
+
+  --p;
+
+  return scanColumn(str, (*p).pos, (*p).col, col, startCol);
+}
+
+size_t
+CDiffColumnIndex::
+scanColumn(const std::string_view &str, size_t pos, int posCol, int col, int &startCol)
+{
+  size_t len = str.size();
+
+  while (pos < len) {
+    size_t pos1 = pos;
+    int    col1 = posCol;
+
+    auto c = static_cast<unsigned char>(str[pos1]);
+
+    if (c < 0x80) {
+      ++pos1;
+
+      if (c == '\t')
+        col1 = (col1/CDiffFile::tabWidth() + 1)*CDiffFile::tabWidth();
+      else
+        ++col1;
+    }
+    else
+      col1 += CDiffFile::charColumns(CDiffFile::decodeChar(str, pos1));
+
+    if (col1 > col)
+      break;
+
+    pos    = pos1;
+    posCol = col1;
+  }
+
+  startCol = posCol;
+
+  return pos;
+}
@@ -0,0 +1,41 @@
+#ifndef CDiffColumnIndex_H
+#define CDiffColumnIndex_H
+
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+// Index of display columns of a (long) line. The byte position and column of a char
+// boundary is recorded every step bytes so the char at a column can be found by a
+// binary search and a short scan instead of scanning the whole line. Lines which are
+// all ascii without tabs need no index (column is byte position).
+class CDiffColumnIndex {
+ public:
+  CDiffColumnIndex(const std::string_view &str);
+
+  // byte position of first char ending after column col (startCol set to column of
+  // char, end of string if col is past end)
+  size_t findColumn(const std::string_view &str, int col, int &startCol) const;
+
+  // scan from byte position pos at column posCol to first char ending after column col
+  static size_t scanColumn(const std::string_view &str, size_t pos, int posCol,
+                           int col, int &startCol);
+
+  // lines shorter than this are scanned without an index
+  static size_t minSize() { return 4096; }
+
+  static size_t step() { return 1024; }
+
+ private:
+  struct Mark {
+    size_t pos { 0 };
+    int    col { 0 };
+  };
+
+  using Marks = std::vector<Mark>;
+
+  bool  simple_ { true }; // ascii without tabs
+  Marks marks_;
+};
+
+#endif
@@ -0,0 +1,1040 @@
+#include <CDiffEngine.h>
+#include <CDiffThreadPool.h>
+#include <CDiffSimd.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <mutex>
+#include <cctype>
+
+// converts ordered runs of matching lines into hunks for the unmatched gaps between them
+class CDiffEngine::Builder {
+ public:
+  Builder(Hunks &hunks, int l=0, int r=0, Progress *progress=nullptr, long total=0) :
+   hunks_(hunks), l_(l), r_(r), l0_(l), r0_(r), progress_(progress), total_(total) {
+  }
+
+  // pass hunks to proc in batches instead of keeping them
+  void setHunkProc(const HunkProc *proc, uint batchSize) {
+    proc_ = proc; batchSize_ = batchSize;
+  }
+
+  // lines [l, l + len) on left match [r, r + len) on right (0-based)
+  void addMatch(int l, int r, int len) {
+    if (len <= 0) return;
+
+    addGap(l, r);
+
+    l_ = l + len;
+    r_ = r + len;
+
+    // matches are added in order so lines before them are done
+    if (progress_ && total_ > 0)
+      progress_->store(int((100L*((l_ - l0_) + (r_ - r0_)))/total_), std::memory_order_relaxed);
+  }
+
+  void finish(int nl, int nr) {
+    addGap(nl, nr);
+
+    l_ = nl;
+    r_ = nr;
+
+    flush();
+  }
+
+  void flush() {
+    if (proc_ && ! hunks_.empty()) {
+      (*proc_)(hunks_);
+
+      hunks_.clear();
+    }
+  }
+
+ private:
+  void addGap(int l, int r) {
+    if (l == l_ && r == r_)
+      return;
+
+    if      (l == l_)
+      hunks_.push_back(Hunk('a', l_, l_, r_ + 1, r));
+    else if (r == r_)
+      hunks_.push_back(Hunk('d', l_ + 1, l, r_, r_));
+    else
+      hunks_.push_back(Hunk('c', l_ + 1, l, r_ + 1, r));
+
+    if (proc_ && hunks_.size() >= batchSize_)
+      flush();
+  }
+
+ private:
+  Hunks    &hunks_;
+  int       l_        { 0 };
+  int       r_        { 0 };
+  int       l0_       { 0 };
+  int       r0_       { 0 };
+  Progress       *progress_  { nullptr };
+  long            total_     { 0 };
+  const HunkProc *proc_      { nullptr };
+  uint            batchSize_ { 0 };
+};
+
+//------
+
+CDiffEngine::
+CDiffEngine()
+{
+}
+
+bool
+CDiffEngine::
+exec(const Ids &lids, const Ids &rids, Hunks &hunks)
+{
+  hunks.clear();
+
+  if (progress_)
+    progress_->store(0);
+
+  // ignored differences are removed by comparing the ids of the normalized text of
+  // each distinct line
+  Ids lids1, rids1;
+
+  Id numIds = 0;
+
+  if (isNormalized(ignoreFlags_, mask_) && lineTable_) {
+    const Ids *normIds = normIds_;
+
+    Ids normIds1;
+
+    if (normIds)
+      numIds = numNormIds_;
+    else {
+      if (! normalizeIds(*lineTable_, ignoreFlags_, mask_, normIds1, numIds,
+                         numThreads_, cancel_))
+        return false;
+
+      normIds = &normIds1;
+    }
+
+    lids1.reserve(lids.size());
+    rids1.reserve(rids.size());
+
+    for (const auto &id : lids) lids1.push_back((*normIds)[id]);
+    for (const auto &id : rids) rids1.push_back((*normIds)[id]);
+
+    lids_ = &lids1;
+    rids_ = &rids1;
+  }
+  else {
+    lids_ = &lids;
+    rids_ = &rids;
+
+    if (lineTable_)
+      numIds = lineTable_->size();
+    else {
+      for (const auto &id : lids) numIds = std::max(numIds, id + 1);
+      for (const auto &id : rids) numIds = std::max(numIds, id + 1);
+    }
+  }
+
+  // skip common leading and trailing lines (compare id arrays a vector at a time)
+  // so only the middle region is diffed
+  int nl = int(lids_->size());
+  int nr = int(rids_->size());
+
+  int nmin = std::min(nl, nr);
+
+  int np = int(CDiffSimd::commonPrefix(lids_->data(), rids_->data(), nmin*sizeof(Id))/sizeof(Id));
+
+  int nm = nmin - np;
+
+  int ns = int(CDiffSimd::commonSuffix(lids_->data() + nl - nm, rids_->data() + nr - nm,
+                                       nm*sizeof(Id))/sizeof(Id));
+
+  int l1 = np, l2 = nl - ns;
+  int r1 = np, r2 = nr - ns;
+
+  bool rc = true;
+
+  try {
+    if (l1 < l2 || r1 < r2) {
+      // hunks are streamed per segment so large serial diffs are segmented too (linear
+      // space myers finds nothing until its top level split is done)
+      if ((numThreads_ > 1 || hunkProc_) && uint((l2 - l1) + (r2 - r1)) >= minParallelLines_)
+        execParallel(numIds, l1, l2, r1, r2, hunks);
+      else
+        execIds(numIds, l1, l2, r1, r2, hunks);
+    }
+  }
+  catch (const Cancelled &) {
+    hunks.clear();
+
+    rc = false;
+  }
+
+  lids_ = nullptr;
+  rids_ = nullptr;
+
+  Counts().swap(counts_);
+  Chains().swap(chains_);
+
+  if (rc && progress_)
+    progress_->store(100);
+
+  return rc;
+}
+
+bool
+CDiffEngine::
+normalize(const std::string_view &str, uint flags, std::string &str1)
+{
+  str1.clear();
+
+  size_t len = str.size();
+
+  if ((flags & IGNORE_CR) && len > 0 && str[len - 1] == '\r')
+    --len;
+
+  // -b and -w also ignore trailing space
+  if (flags & (IGNORE_ALL_SPACE | IGNORE_SPACE_CHANGE | IGNORE_TRAILING_SPACE)) {
+    while (len > 0 && isspace(static_cast<unsigned char>(str[len - 1])))
+      --len;
+  }
+
+  bool space = false;
+
+  for (size_t i = 0; i < len; ++i) {
+    auto c = static_cast<unsigned char>(str[i]);
+
+    // remove all space or replace runs of space by one space
+    if ((flags & (IGNORE_ALL_SPACE | IGNORE_SPACE_CHANGE)) && isspace(c)) {
+      if (! (flags & IGNORE_ALL_SPACE) && ! space)
+        str1 += ' ';
+
+      space = true;
+
+      continue;
+    }
+
+    space = false;
+
+    if (flags & IGNORE_CASE)
+      c = static_cast<unsigned char>(tolower(c));
+
+    str1 += char(c);
+  }
+
+  return (str1 != str);
+}
+
+bool
+CDiffEngine::
+normalizeIds(const CDiffLineTable &lineTable, uint flags, const CDiffMask *mask,
+             Ids &normIds, Id &numIds, int numThreads, const Cancel *cancel)
+{
+  // normalized text (position in chunk text) and hash of each line
+  struct Norm {
+    uint64_t hash    { 0 };
+    size_t   pos     { 0 };
+    size_t   len     { 0 };
+    bool     changed { false };
+  };
+
+  struct Chunk {
+    Id                begin { 0 };
+    Id                end   { 0 };
+    std::string       text;
+    std::vector<Norm> norms;
+  };
+
+  auto isCancelled = [&]() { return (cancel && cancel->load()); };
+
+  Id numLines = lineTable.size();
+
+  auto normalizeChunk = [&](Chunk &chunk) {
+    chunk.norms.resize(chunk.end - chunk.begin);
+
+    std::string str, mstr;
+
+    for (Id id = chunk.begin; id < chunk.end; ++id) {
+      if ((id & 0xffff) == 0 && isCancelled())
+        return;
+
+      std::string_view line = lineTable.line(id);
+
+      auto &norm = chunk.norms[id - chunk.begin];
+
+      // mask before normalize as rules match original text
+      bool masked = (mask && mask->apply(line, mstr));
+
+      if (masked)
+        line = mstr;
+
+      if (! normalize(line, flags, str)) {
+        // unchanged line reuses its view and hash
+        if (! masked) {
+          norm.hash = lineTable.hash(id);
+          continue;
+        }
+
+        str = mstr;
+      }
+
+      norm.hash    = CDiffLineTable::hashLine(str.data(), str.size());
+      norm.pos     = chunk.text.size();
+      norm.len     = str.size();
+      norm.changed = true;
+
+      chunk.text += str;
+    }
+  };
+
+  // split ids into chunks
+  Id minChunkSize = 65536;
+
+  Id numChunks = std::max(std::min(Id(std::max(numThreads, 1)), numLines/minChunkSize), Id(1));
+
+  std::vector<Chunk> chunks(numChunks);
+
+  for (Id i = 0; i < numChunks; ++i) {
+    chunks[i].begin = Id(uint64_t(numLines)*i/numChunks);
+    chunks[i].end   = Id(uint64_t(numLines)*(i + 1)/numChunks);
+  }
+
+  if (chunks.size() > 1) {
+    CDiffThreadPool pool(int(chunks.size()));
+
+    CDiffThreadPool::Tasks tasks;
+
+    for (auto &chunk : chunks)
+      tasks.push_back([&normalizeChunk, &chunk]() { normalizeChunk(chunk); });
+
+    pool.run(tasks);
+  }
+  else
+    normalizeChunk(chunks[0]);
+
+  if (isCancelled())
+    return false;
+
+  //---
+
+  // intern normalized lines in order (views of chunk text are only used while
+  // interning)
+  CDiffLineTable normTable;
+
+  normIds.resize(numLines);
+
+  for (const auto &chunk : chunks) {
+    for (Id id = chunk.begin; id < chunk.end; ++id) {
+      const auto &norm = chunk.norms[id - chunk.begin];
+
+      if (norm.changed)
+        normIds[id] = normTable.add(std::string_view(chunk.text.data() + norm.pos, norm.len),
+                                    norm.hash);
+      else
+        normIds[id] = normTable.add(lineTable.line(id), norm.hash);
+    }
+  }
+
+  numIds = normTable.size();
+
+  return true;
+}
+
+// diff current ids for left lines [l1, l2) and right lines [r1, r2) on this thread
+void
+CDiffEngine::
+execIds(Id numIds, int l1, int l2, int r1, int r2, Hunks &hunks)
+{
+  // histogram falls back to patience
+  if (algorithm_ == Algorithm::PATIENCE || algorithm_ == Algorithm::HISTOGRAM)
+    counts_.resize(numIds);
+
+  if (algorithm_ == Algorithm::HISTOGRAM) {
+    chains_.resize(numIds);
+
+    histogramDepth_   = 0;
+    histogramWork_    = 0;
+    histogramMaxWork_ = 32*(long(l2 - l1) + long(r2 - r1) + 1);
+  }
+
+  Builder builder(hunks, l1, r1, progress_, long(l2 - l1) + long(r2 - r1));
+
+  if (hunkProc_)
+    builder.setHunkProc(&hunkProc_, batchSize_);
+
+  execRange(l1, l2, r1, r2, builder);
+
+  builder.finish(l2, r2);
+
+  Counts().swap(counts_);
+  Chains().swap(chains_);
+}
+
+// Split the inputs into independent segments at lines which are unique in both
+// files (longest increasing sequence of them so segments are in order on both sides)
+// and diff the segments in parallel (or in order when only streaming hunks). Each
+// segment uses its own engine with the ids renumbered so per id work arrays are
+// sized to the segment.
+void
+CDiffEngine::
+execParallel(Id numIds, int l1, int l2, int r1, int r2, Hunks &hunks)
+{
+  struct Anchor {
+    int l, r;
+  };
+
+  std::vector<Anchor> anchors;
+
+  {
+    std::vector<Count> counts(numIds);
+
+    for (int l = l1; l < l2; ++l) { auto &count = counts[lid(l)]; ++count.lcount; count.lpos = l; }
+    for (int r = r1; r < r2; ++r) { auto &count = counts[rid(r)]; ++count.rcount; count.rpos = r; }
+
+    for (int l = l1; l < l2; ++l) {
+      const auto &count = counts[lid(l)];
+
+      if (count.lcount == 1 && count.rcount == 1)
+        anchors.push_back(Anchor{l, count.rpos});
+    }
+  }
+
+  // longest increasing subsequence of right positions
+  std::vector<Anchor> lis;
+
+  if (! anchors.empty()) {
+    std::vector<int> tails;
+    std::vector<int> prev(anchors.size(), -1);
+
+    for (size_t i = 0; i < anchors.size(); ++i) {
+      auto pt = std::lower_bound(tails.begin(), tails.end(), anchors[i].r,
+        [&](int ind, int r) { return anchors[size_t(ind)].r < r; });
+
+      if (pt != tails.begin())
+        prev[i] = *(pt - 1);
+
+      if (pt == tails.end())
+        tails.push_back(int(i));
+      else
+        *pt = int(i);
+    }
+
+    for (int i = tails.back(); i >= 0; i = prev[size_t(i)])
+      lis.push_back(anchors[size_t(i)]);
+
+    std::reverse(lis.begin(), lis.end());
+  }
+
+  anchors.clear();
+
+  //---
+
+  // cut into segments of roughly equal size (several per thread for load balancing)
+  struct Segment {
+    int   l1, l2, r1, r2;
+    Hunks hunks;
+    bool  done;
+  };
+
+  std::vector<Segment> segments;
+
+  int minTarget = int(minParallelLines_/4);
+  int target    = std::max(((l2 - l1) + (r2 - r1))/(4*numThreads_), minTarget);
+
+  // when streaming, leading segments start small (doubling in size) so the first
+  // hunks are delivered early
+  int segmentTarget = (hunkProc_ ? minTarget : target);
+
+  int sl = l1, sr = r1;
+
+  for (const auto &anchor : lis) {
+    if ((anchor.l - sl) + (anchor.r - sr) < segmentTarget)
+      continue;
+
+    segments.push_back(Segment{sl, anchor.l, sr, anchor.r, Hunks(), false});
+
+    sl = anchor.l;
+    sr = anchor.r;
+
+    segmentTarget = std::min(2*segmentTarget, target);
+  }
+
+  segments.push_back(Segment{sl, l2, sr, r2, Hunks(), false});
+
+  lis.clear();
+
+  //---
+
+  long total = long(l2 - l1) + long(r2 - r1);
+
+  std::atomic<long> done { 0 };
+
+  // with a hunk proc, completed segments are delivered in order as soon as all the
+  // segments before them are done
+  std::mutex deliverMutex;
+  size_t     deliverInd = 0;
+
+  auto deliverSegments = [&]() {
+    std::lock_guard<std::mutex> lock(deliverMutex);
+
+    while (deliverInd < segments.size() && segments[deliverInd].done) {
+      auto &segment = segments[deliverInd++];
+
+      if (! segment.hunks.empty())
+        hunkProc_(segment.hunks);
+
+      Hunks().swap(segment.hunks);
+    }
+  };
+
+  CDiffThreadPool::Tasks tasks;
+
+  for (auto &segment : segments) {
+    tasks.push_back([&]() {
+      if (cancel_ && cancel_->load())
+        return;
+
+      // renumber ids used in segment
+      std::unordered_map<Id, Id> idMap;
+
+      idMap.reserve(size_t(segment.l2 - segment.l1));
+
+      auto mapId = [&](Id id) {
+        return idMap.emplace(id, Id(idMap.size())).first->second;
+      };
+
+      Ids lids, rids;
+
+      lids.reserve(size_t(segment.l2 - segment.l1));
+      rids.reserve(size_t(segment.r2 - segment.r1));
+
+      for (int l = segment.l1; l < segment.l2; ++l) lids.push_back(mapId(lid(l)));
+      for (int r = segment.r1; r < segment.r2; ++r) rids.push_back(mapId(rid(r)));
+
+      CDiffEngine engine;
+
+      engine.setAlgorithm       (algorithm_);
+      engine.setLinearSpaceLines(linearSpaceLines_);
+      engine.setMaxTraceBytes   (maxTraceBytes_);
+      engine.setCancel          (cancel_);
+
+      engine.lids_ = &lids;
+      engine.rids_ = &rids;
+
+      try {
+        engine.execIds(Id(idMap.size()), 0, int(lids.size()), 0, int(rids.size()), segment.hunks);
+      }
+      catch (const Cancelled &) {
+        return;
+      }
+
+      // offset hunks to segment start
+      for (auto &hunk : segment.hunks) {
+        hunk.lstart += segment.l1; hunk.lend += segment.l1;
+        hunk.rstart += segment.r1; hunk.rend += segment.r1;
+      }
+
+      long n = (done += long(segment.l2 - segment.l1) + long(segment.r2 - segment.r1));
+
+      if (progress_)
+        progress_->store(int((100L*n)/total), std::memory_order_relaxed);
+
+      if (hunkProc_) {
+        { std::lock_guard<std::mutex> lock(deliverMutex); segment.done = true; }
+
+        deliverSegments();
+      }
+    });
+  }
+
+  CDiffThreadPool pool(numThreads_);
+
+  pool.run(tasks);
+
+  checkCancel();
+
+  if (hunkProc_)
+    return;
+
+  //---
+
+  size_t nh = 0;
+
+  for (const auto &segment : segments)
+    nh += segment.hunks.size();
+
+  hunks.reserve(nh);
+
+  for (auto &segment : segments) {
+    hunks.insert(hunks.end(), segment.hunks.begin(), segment.hunks.end());
+
+    Hunks().swap(segment.hunks);
+  }
+}
+
+// diff left lines [l1, l2) against right lines [r1, r2) using the current algorithm,
+// common leading and trailing lines are matched up front
+void
+CDiffEngine::
+execRange(int l1, int l2, int r1, int r2, Builder &builder)
+{
+  checkCancel();
+
+  int np = 0;
+
+  while (l1 + np < l2 && r1 + np < r2 && isEqual(l1 + np, r1 + np))
+    ++np;
+
+  builder.addMatch(l1, r1, np);
+
+  l1 += np;
+  r1 += np;
+
+  int ns = 0;
+
+  while (l2 - ns > l1 && r2 - ns > r1 && isEqual(l2 - ns - 1, r2 - ns - 1))
+    ++ns;
+
+  l2 -= ns;
+  r2 -= ns;
+
+  if (l1 < l2 && r1 < r2) {
+    switch (algorithm_) {
+      case Algorithm::PATIENCE : execPatience (l1, l2, r1, r2, builder); break;
+      case Algorithm::HISTOGRAM: execHistogram(l1, l2, r1, r2, builder); break;
+      default                  : execMyers    (l1, l2, r1, r2, builder); break;
+    }
+  }
+
+  builder.addMatch(l2, r2, ns);
+}
+
+// Myers diff of left lines [l1, l2) against right lines [r1, r2)
+void
+CDiffEngine::
+execMyers(int l1, int l2, int r1, int r2, Builder &builder)
+{
+  if (uint((l2 - l1) + (r2 - r1)) >= linearSpaceLines_)
+    execMyersLinear(l1, l2, r1, r2, builder);
+  else
+    execMyersTrace(l1, l2, r1, r2, builder);
+}
+
+// Myers O(ND) greedy diff. The furthest reaching x for each diagonal is kept per
+// edit distance so the snakes can be recovered by backtracking from the end point
+// (O(D^2) space). Switches to linear space Myers if the kept state exceeds the
+// maximum trace bytes.
+void
+CDiffEngine::
+execMyersTrace(int l1, int l2, int r1, int r2, Builder &builder, bool limitTrace)
+{
+  int n = l2 - l1;
+  int m = r2 - r1;
+
+  if (n == 0 || m == 0)
+    return;
+
+  int max = n + m;
+
+  std::vector<int> v(size_t(2*max + 3), 0);
+
+  auto V = [&](int k) -> int & { return v[size_t(k + max + 1)]; };
+
+  // trace[d] holds V[-d..d] after step d
+  std::vector<std::vector<int>> trace;
+
+  size_t traceBytes = 0;
+
+  int d = 0;
+
+  for ( ; d <= max; ++d) {
+    checkCancel();
+
+    traceBytes += size_t(2*d + 1)*sizeof(int);
+
+    if (limitTrace && traceBytes > maxTraceBytes_) {
+      std::vector<std::vector<int>>().swap(trace);
+
+      execMyersLinear(l1, l2, r1, r2, builder);
+
+      return;
+    }
+
+    bool done = false;
+
+    for (int k = -d; k <= d; k += 2) {
+      int x;
+
+      if (k == -d || (k != d && V(k - 1) < V(k + 1)))
+        x = V(k + 1);
+      else
+        x = V(k - 1) + 1;
+
+      int y = x - k;
+
+      while (x < n && y < m && isEqual(l1 + x, r1 + y)) {
+        ++x; ++y;
+      }
+
+      V(k) = x;
+
+      if (x >= n && y >= m) {
+        done = true;
+        break;
+      }
+    }
+
+    trace.emplace_back(v.begin() + (max + 1 - d), v.begin() + (max + 1 + d + 1));
+
+    if (done)
+      break;
+  }
+
+  //---
+
+  // backtrack collecting snakes (in reverse order)
+  struct Snake {
+    int x, y, len;
+  };
+
+  std::vector<Snake> snakes;
+
+  int x = n, y = m;
+
+  for ( ; d > 0; --d) {
+    const auto &pv = trace[size_t(d - 1)];
+
+    auto PV = [&](int k) { return pv[size_t(k + d - 1)]; };
+
+    int k = x - y;
+
+    int pk = ((k == -d || (k != d && PV(k - 1) < PV(k + 1))) ? k + 1 : k - 1);
+
+    int px = PV(pk);
+    int py = px - pk;
+
+    // start of snake after the single edit from (px, py)
+    int sx = (pk == k + 1 ? px : px + 1);
+
+    if (x > sx)
+      snakes.push_back(Snake{sx, sx - k, x - sx});
+
+    x = px;
+    y = py;
+  }
+
+  if (x > 0)
+    snakes.push_back(Snake{0, 0, x});
+
+  for (auto ps = snakes.rbegin(); ps != snakes.rend(); ++ps)
+    builder.addMatch(l1 + (*ps).x, r1 + (*ps).y, (*ps).len);
+}
+
+// Linear space Myers. Searches forwards and backwards at the same time to find the
+// middle snake of an optimal path, matches it and recurses on the two halves, so
+// memory is O(N+M) and the edit script is still minimal.
+void
+CDiffEngine::
+execMyersLinear(int l1, int l2, int r1, int r2, Builder &builder)
+{
+  int n = l2 - l1;
+  int m = r2 - r1;
+
+  if (n == 0 || m == 0)
+    return;
+
+  int delta = n - m;
+  int max   = (n + m + 1)/2;
+  bool odd  = (delta & 1);
+
+  size_t vsize = size_t(2*max + 3);
+
+  if (vf_.size() < vsize) vf_.resize(vsize);
+  if (vb_.size() < vsize) vb_.resize(vsize);
+
+  int *vf = &vf_[size_t(max + 1)];
+  int *vb = &vb_[size_t(max + 1)];
+
+  vf[1] = 0;
+  vb[1] = 0;
+
+  // middle snake (sx, sy) -> (ex, ey) and edit distance of path through it
+  int sx = 0, sy = 0, ex = 0, ey = 0, dist = -1;
+
+  for (int d = 0; d <= max && dist < 0; ++d) {
+    checkCancel();
+
+    // forward paths
+    for (int k = -d; k <= d; k += 2) {
+      int x = ((k == -d || (k != d && vf[k - 1] < vf[k + 1])) ? vf[k + 1] : vf[k - 1] + 1);
+      int y = x - k;
+
+      int x0 = x, y0 = y;
+
+      while (x < n && y < m && isEqual(l1 + x, r1 + y)) {
+        ++x; ++y;
+      }
+
+      vf[k] = x;
+
+      // reverse diagonal for this forward diagonal
+      int c = delta - k;
+
+      if (odd && c >= -(d - 1) && c <= d - 1 && x + vb[c] >= n) {
+        sx = x0; sy = y0; ex = x; ey = y; dist = 2*d - 1;
+        break;
+      }
+    }
+
+    if (dist >= 0)
+      break;
+
+    // reverse paths (x measured from end)
+    for (int k = -d; k <= d; k += 2) {
+      int x = ((k == -d || (k != d && vb[k - 1] < vb[k + 1])) ? vb[k + 1] : vb[k - 1] + 1);
+      int y = x - k;
+
+      int x0 = x, y0 = y;
+
+      while (x < n && y < m && isEqual(l2 - x - 1, r2 - y - 1)) {
+        ++x; ++y;
+      }
+
+      vb[k] = x;
+
+      int c = delta - k;
+
+      if (! odd && c >= -d && c <= d && x + vf[c] >= n) {
+        sx = n - x; sy = m - y; ex = n - x0; ey = m - y0; dist = 2*d;
+        break;
+      }
+    }
+  }
+
+  //---
+
+  if (dist <= 1) {
+    // at most one edit so trace version only needs O(N) space (no trace limit so any
+    // limit can't switch back to linear space)
+    execMyersTrace(l1, l2, r1, r2, builder, /*limitTrace*/false);
+    return;
+  }
+
+  execMyersLinear(l1, l1 + sx, r1, r1 + sy, builder);
+
+  builder.addMatch(l1 + sx, r1 + sy, ex - sx);
+
+  execMyersLinear(l1 + ex, l2, r1 + ey, r2, builder);
+}
+
+// Patience diff. Lines which occur exactly once in both ranges are used as anchors,
+// the longest increasing sequence of anchors is matched and the gaps between them
+// are diffed recursively. Falls back to Myers when there are no unique lines.
+void
+CDiffEngine::
+execPatience(int l1, int l2, int r1, int r2, Builder &builder)
+{
+  // counts_ is all zero on entry and reset for the ids used before recursing
+  for (int l = l1; l < l2; ++l) {
+    auto &count = counts_[lid(l)];
+
+    ++count.lcount; count.lpos = l;
+  }
+
+  for (int r = r1; r < r2; ++r) {
+    auto &count = counts_[rid(r)];
+
+    ++count.rcount; count.rpos = r;
+  }
+
+  // unique lines in left order
+  struct Anchor {
+    int l, r;
+  };
+
+  std::vector<Anchor> anchors;
+
+  for (int l = l1; l < l2; ++l) {
+    const auto &count = counts_[lid(l)];
+
+    if (count.lcount == 1 && count.rcount == 1)
+      anchors.push_back(Anchor{l, count.rpos});
+  }
+
+  for (int l = l1; l < l2; ++l) counts_[lid(l)] = Count();
+  for (int r = r1; r < r2; ++r) counts_[rid(r)] = Count();
+
+  if (anchors.empty()) {
+    execMyers(l1, l2, r1, r2, builder);
+    return;
+  }
+
+  //---
+
+  // longest increasing subsequence of right positions (patience sort)
+  auto na = anchors.size();
+
+  std::vector<int> tails; // anchor index of smallest tail for each pile
+  std::vector<int> prev(na, -1);
+
+  for (size_t i = 0; i < na; ++i) {
+    auto pt = std::lower_bound(tails.begin(), tails.end(), anchors[i].r,
+      [&](int ind, int r) { return anchors[size_t(ind)].r < r; });
+
+    if (pt != tails.begin())
+      prev[i] = *(pt - 1);
+
+    if (pt == tails.end())
+      tails.push_back(int(i));
+    else
+      *pt = int(i);
+  }
+
+  std::vector<Anchor> lis;
+
+  for (int i = tails.back(); i >= 0; i = prev[size_t(i)])
+    lis.push_back(anchors[size_t(i)]);
+
+  std::reverse(lis.begin(), lis.end());
+
+  //---
+
+  int l = l1, r = r1;
+
+  for (const auto &anchor : lis) {
+    execRange(l, anchor.l, r, anchor.r, builder);
+
+    builder.addMatch(anchor.l, anchor.r, 1);
+
+    l = anchor.l + 1;
+    r = anchor.r + 1;
+  }
+
+  execRange(l, l2, r, r2, builder);
+}
+
+// Histogram diff (as used by git/jgit). Finds the longest common region containing
+// the lowest occurrence left line, matches it, diffs the lines before it recursively
+// and loops on the lines after it. Falls back to Myers when every line occurs too
+// often. Falls back to patience when the recursion is too deep or the lines scanned
+// exceed a multiple of the diffed lines (inputs which only give tiny regions, e.g.
+// swapped adjacent lines, are quadratic in histogram and Myers).
+void
+CDiffEngine::
+execHistogram(int l1, int l2, int r1, int r2, Builder &builder)
+{
+  static const int maxChainLen = 64;
+  static const int maxDepth    = 64;
+
+  // chain of left positions for each line id (in increasing order), chains_ is
+  // reset for the ids used before recursing
+  std::vector<int> next;
+
+  while (l1 < l2 && r1 < r2) {
+    histogramWork_ += long(l2 - l1) + long(r2 - r1);
+
+    if (histogramDepth_ >= maxDepth || histogramWork_ > histogramMaxWork_) {
+      execPatience(l1, l2, r1, r2, builder);
+      return;
+    }
+
+    next.assign(size_t(l2 - l1), -1);
+
+    for (int l = l1; l < l2; ++l) {
+      auto &chain = chains_[lid(l)];
+
+      if (chain.tail >= 0)
+        next[size_t(chain.tail - l1)] = l;
+      else
+        chain.head = l;
+
+      chain.tail = l;
+
+      ++chain.count;
+    }
+
+    auto leftCount = [&](int l) {
+      return chains_[lid(l)].count;
+    };
+
+    //---
+
+    int bestCount = maxChainLen + 1;
+    int bl1 = 0, bl2 = 0, br1 = 0, br2 = 0;
+
+    for (int r = r1; r < r2; ) {
+      if (((r - r1) & 0xfff) == 0)
+        checkCancel();
+
+      const auto &rchain = chains_[rid(r)];
+
+      if (rchain.count == 0 || rchain.count > bestCount) {
+        ++r;
+        continue;
+      }
+
+      int nextR = r + 1;
+
+      for (int l = rchain.head; l >= 0; ) {
+        // extend match around (l, r)
+        int sl = l, sr = r, el = l + 1, er = r + 1;
+
+        int count = rchain.count;
+
+        while (sl > l1 && sr > r1 && isEqual(sl - 1, sr - 1)) {
+          --sl; --sr;
+
+          count = std::min(count, leftCount(sl));
+        }
+
+        while (el < l2 && er < r2 && isEqual(el, er)) {
+          count = std::min(count, leftCount(el));
+
+          ++el; ++er;
+        }
+
+        nextR = std::max(nextR, er);
+
+        if (count < bestCount || (count == bestCount && el - sl > bl2 - bl1)) {
+          bestCount = count;
+
+          bl1 = sl; bl2 = el;
+          br1 = sr; br2 = er;
+        }
+
+        // skip left positions inside the matched region
+        l = next[size_t(l - l1)];
+
+        while (l >= 0 && l < el)
+          l = next[size_t(l - l1)];
+      }
+
+      r = nextR;
+    }
+
+    for (int l = l1; l < l2; ++l)
+      chains_[lid(l)] = Chain();
+
+    // free chain links before recursing (live memory is O(N) not O(depth*N))
+    std::vector<int>().swap(next);
+
+    if (bestCount > maxChainLen) {
+      execMyers(l1, l2, r1, r2, builder);
+      return;
+    }
+
+    ++histogramDepth_;
+
+    execRange(l1, bl1, r1, br1, builder);
+
+    --histogramDepth_;
+
+    builder.addMatch(bl1, br1, bl2 - bl1);
+
+    // lines after region have no common prefix (region is maximal) or suffix (range
+    // suffix already matched)
+    l1 = bl2;
+    r1 = br2;
+  }
+}
@@ -0,0 +1,190 @@
+#ifndef CDiffEngine_H
+#define CDiffEngine_H
+
+#include <CDiffLineTable.h>
+#include <CDiffMask.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+// In-process line diff. Produces the same hunks as "diff" normal format output
+// ("<l1>,<l2><c><r1>,<r2>") directly from already loaded lines. Lines are
+// compared by their id in the shared line table.
+class CDiffEngine {
+ public:
+  enum class Algorithm {
+    MYERS,
+    PATIENCE,
+    HISTOGRAM
+  };
+
+  // hunk in diff normal format numbering (1-based, for add/delete the start/end on
+  // the empty side is the line the change is after)
+  struct Hunk {
+    char c { '\0' };
+    int  lstart { 0 }, lend { 0 };
+    int  rstart { 0 }, rend { 0 };
+
+    Hunk(char c1=0, int lstart1=0, int lend1=0, int rstart1=0, int rend1=0) :
+     c(c1), lstart(lstart1), lend(lend1), rstart(rstart1), rend(rend1) {
+    }
+  };
+
+  // line differences to ignore (as diff -w, -b, -Z, -i and --strip-trailing-cr)
+  enum IgnoreFlags : uint {
+    IGNORE_NONE           = 0,
+    IGNORE_ALL_SPACE      = (1<<0),
+    IGNORE_SPACE_CHANGE   = (1<<1),
+    IGNORE_TRAILING_SPACE = (1<<2),
+    IGNORE_CASE           = (1<<3),
+    IGNORE_CR             = (1<<4)
+  };
+
+  using Id    = CDiffLineTable::Id;
+  using Ids   = std::vector<Id>;
+  using Hunks = std::vector<Hunk>;
+
+  using Cancel   = std::atomic<bool>;
+  using Progress = std::atomic<int>;
+  using HunkProc = std::function<void(const Hunks &hunks)>;
+
+ public:
+  CDiffEngine();
+
+  const Algorithm &algorithm() const { return algorithm_; }
+  void setAlgorithm(const Algorithm &a) { algorithm_ = a; }
+
+  uint ignoreFlags() const { return ignoreFlags_; }
+  void setIgnoreFlags(uint flags) { ignoreFlags_ = flags; }
+
+  bool isIgnoreWhiteSpace() const { return (ignoreFlags_ & IGNORE_ALL_SPACE); }
+  void setIgnoreWhiteSpace(bool b) {
+    ignoreFlags_ = (b ? ignoreFlags_ | IGNORE_ALL_SPACE : ignoreFlags_ & ~IGNORE_ALL_SPACE); }
+
+  // optional regex mask/ignore rules applied to lines before ignore flags
+  const CDiffMask *mask() const { return mask_; }
+  void setMask(const CDiffMask *mask) { mask_ = mask; }
+
+  // optional map of line table id to id of normalized line for the ignore flags (see
+  // normalizeIds), computed by exec if not set
+  void setNormIds(const Ids *ids, Id numIds) { normIds_ = ids; numNormIds_ = numIds; }
+
+  // number of threads used for large inputs (split into segments at unique lines)
+  int numThreads() const { return numThreads_; }
+  void setNumThreads(int n) { numThreads_ = n; }
+
+  // minimum total lines of a range diffed with linear space Myers. Below this size the
+  // faster variant which keeps the search state for every edit distance is used
+  uint linearSpaceLines() const { return linearSpaceLines_; }
+  void setLinearSpaceLines(uint n) { linearSpaceLines_ = n; }
+
+  // maximum bytes of search state kept by the faster Myers variant (O(D^2)), ranges
+  // needing more switch to linear space Myers so peak memory stays O(N+M)
+  size_t maxTraceBytes() const { return maxTraceBytes_; }
+  void setMaxTraceBytes(size_t n) { maxTraceBytes_ = n; }
+
+  // minimum total lines for parallel diff
+  uint minParallelLines() const { return minParallelLines_; }
+  void setMinParallelLines(uint n) { minParallelLines_ = n; }
+
+  const CDiffLineTable *lineTable() const { return lineTable_; }
+  void setLineTable(const CDiffLineTable *t) { lineTable_ = t; }
+
+  // optional flag checked while running to stop early
+  const Cancel *cancel() const { return cancel_; }
+  void setCancel(const Cancel *c) { cancel_ = c; }
+
+  // optional percentage of lines diffed (updated while running)
+  Progress *progress() const { return progress_; }
+  void setProgress(Progress *p) { progress_ = p; }
+
+  // optional proc called with batches of hunks (in order) as they are found, when
+  // set the hunks are not returned by exec
+  const HunkProc &hunkProc() const { return hunkProc_; }
+  void setHunkProc(const HunkProc &proc, uint batchSize=1024) {
+    hunkProc_ = proc; batchSize_ = batchSize; }
+
+  // returns false if cancelled
+  bool exec(const Ids &lids, const Ids &rids, Hunks &hunks);
+
+  // line with ignored differences removed (returns false if unchanged)
+  static bool normalize(const std::string_view &str, uint flags, std::string &str1);
+
+  // map each line table id to the id of its normalized (masked) line so lines which only
+  // differ by ignored differences have the same id. Lines are normalized and hashed
+  // in parallel and then interned (returns false if cancelled)
+  static bool normalizeIds(const CDiffLineTable &lineTable, uint flags, const CDiffMask *mask,
+                           Ids &normIds, Id &numIds, int numThreads=1,
+                           const Cancel *cancel=nullptr);
+
+  // check if ignore flags or mask change lines
+  static bool isNormalized(uint flags, const CDiffMask *mask) {
+    return (flags != IGNORE_NONE || (mask && ! mask->empty())); }
+
+ private:
+  class Builder;
+
+  struct Cancelled { };
+
+  void checkCancel() const {
+    if (cancel_ && cancel_->load(std::memory_order_relaxed))
+      throw Cancelled();
+  }
+
+  bool isEqual(int l, int r) const { return (lid(l) == rid(r)); }
+
+  Id lid(int l) const { return (*lids_)[size_t(l)]; }
+  Id rid(int r) const { return (*rids_)[size_t(r)]; }
+
+  void execIds(Id numIds, int l1, int l2, int r1, int r2, Hunks &hunks);
+
+  void execParallel(Id numIds, int l1, int l2, int r1, int r2, Hunks &hunks);
+
+  void execRange(int l1, int l2, int r1, int r2, Builder &builder);
+
+  void execMyers      (int l1, int l2, int r1, int r2, Builder &builder);
+  void execMyersTrace (int l1, int l2, int r1, int r2, Builder &builder,
+                       bool limitTrace=true);
+  void execMyersLinear(int l1, int l2, int r1, int r2, Builder &builder);
+  void execPatience (int l1, int l2, int r1, int r2, Builder &builder);
+  void execHistogram(int l1, int l2, int r1, int r2, Builder &builder);
+
+ private:
+  struct Count {
+    int lcount { 0 }, lpos { -1 };
+    int rcount { 0 }, rpos { -1 };
+  };
+
+  struct Chain {
+    int head { -1 }, tail { -1 }, count { 0 };
+  };
+
+  using Counts = std::vector<Count>;
+  using Chains = std::vector<Chain>;
+
+  Algorithm             algorithm_        { Algorithm::MYERS };
+  uint                  ignoreFlags_      { IGNORE_NONE };
+  int                   numThreads_       { 1 };
+  uint                  linearSpaceLines_ { 10000 };
+  size_t                maxTraceBytes_    { 16*1024*1024 };
+  uint                  minParallelLines_ { 65536 };
+  std::vector<int>      vf_, vb_;         // linear space myers forward/backward V
+  const CDiffLineTable *lineTable_        { nullptr };
+  const Cancel         *cancel_           { nullptr };
+  Progress             *progress_         { nullptr };
+  HunkProc              hunkProc_;
+  uint                  batchSize_        { 1024 };
+  const Ids            *lids_             { nullptr };
+  const Ids            *rids_             { nullptr };
+  const CDiffMask      *mask_             { nullptr };
+  const Ids            *normIds_          { nullptr };
+  Id                    numNormIds_       { 0 };
+  Counts                counts_;          // patience per id counts
+  Chains                chains_;          // histogram per id chains
+  int                   histogramDepth_   { 0 }; // histogram recursion depth
+  long                  histogramWork_    { 0 }; // histogram lines scanned
+  long                  histogramMaxWork_ { 0 }; // histogram scan limit before myers
+};
+
+#endif
@@ -0,0 +1,409 @@
+#include <CDiffFile.h>
+#include <CDiffLineTable.h>
+#include <CDiffSimd.h>
+#include <CDiffThreadPool.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+CDiffFile::
+CDiffFile()
+{
+}
+
+CDiffFile::
+~CDiffFile()
+{
+  close();
+}
+
+bool
+CDiffFile::
+open(const std::string &fileName, int numThreads)
+{
+  close();
+
+  fileName_ = fileName;
+
+  int fd = ::open(fileName.c_str(), O_RDONLY);
+
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+
+  if (fstat(fd, &st) != 0 || ! S_ISREG(st.st_mode)) {
+    ::close(fd);
+    return false;
+  }
+
+  size_ = size_t(st.st_size);
+
+  if      (copy_) {
+    buffer_.resize(size_);
+
+    size_t pos = 0;
+
+    while (pos < size_) {
+      ssize_t n = ::read(fd, &buffer_[pos], size_ - pos);
+
+      if (n < 0) {
+        ::close(fd);
+        buffer_.clear();
+        size_ = 0;
+        return false;
+      }
+
+      // file truncated while reading
+      if (n == 0)
+        break;
+
+      pos += size_t(n);
+    }
+
+    buffer_.resize(pos);
+
+    size_ = pos;
+    data_ = buffer_.data();
+  }
+  // empty file has no mapping
+  else if (size_ > 0) {
+    void *p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (p == MAP_FAILED) {
+      ::close(fd);
+      size_ = 0;
+      return false;
+    }
+
+    // lines are read front to back
+    (void) madvise(p, size_, MADV_SEQUENTIAL);
+
+    data_   = static_cast<const char *>(p);
+    mapped_ = true;
+  }
+
+  // mapping stays valid after close
+  ::close(fd);
+
+  indexLines(numThreads);
+
+  return true;
+}
+
+void
+CDiffFile::
+close()
+{
+  if (mapped_)
+    munmap(const_cast<char *>(data_), size_);
+
+  std::string().swap(buffer_);
+
+  mapped_ = false;
+  data_   = nullptr;
+  size_   = 0;
+
+  offsets_.assign(1, 0);
+
+  hashes_.clear();
+
+  numCRLF_    = 0;
+  maxColumns_ = 0;
+
+  std::lock_guard<std::mutex> lock(columnMutex_);
+
+  columnIndices_.clear();
+}
+
+size_t
+CDiffFile::
+columnPos(int i, int col, int &startCol) const
+{
+  auto str = text(i);
+
+  if (str.size() < CDiffColumnIndex::minSize())
+    return CDiffColumnIndex::scanColumn(str, 0, 0, col, startCol);
+
+  const CDiffColumnIndex *index = nullptr;
+
+  {
+    std::lock_guard<std::mutex> lock(columnMutex_);
+
+    auto &indexP = columnIndices_[i];
+
+    if (! indexP)
+      indexP = std::make_unique<CDiffColumnIndex>(str);
+
+    index = indexP.get();
+  }
+
+  return index->findColumn(str, col, startCol);
+}
+
+void
+CDiffFile::
+commonLines(const CDiffFile &file1, const CDiffFile &file2, int &prefix, int &suffix)
+{
+  int n1 = file1.numLines();
+  int n2 = file2.numLines();
+
+  auto sameLine = [&](int i1, int i2) {
+    return (file1.hash(i1) == file2.hash(i2) && file1.lineSize(i1) == file2.lineSize(i2));
+  };
+
+  int n = std::min(n1, n2);
+
+  prefix = 0;
+
+  while (prefix < n && sameLine(prefix, prefix))
+    ++prefix;
+
+  suffix = 0;
+
+  while (suffix < n - prefix && sameLine(n1 - suffix - 1, n2 - suffix - 1))
+    ++suffix;
+}
+
+void
+CDiffFile::
+indexLines(int numThreads)
+{
+  // split into chunks starting at line starts
+  int numChunks = int(std::min(size_t(std::max(numThreads, 1)), size_/minChunkSize() + 1));
+
+  std::vector<Chunk> chunks;
+
+  size_t begin = 0;
+
+  for (int i = 1; i <= numChunks && begin < size_; ++i) {
+    size_t end = size_;
+
+    if (i < numChunks) {
+      size_t pos = std::max(begin, size_t(double(size_)*i/numChunks));
+
+      auto *nl = static_cast<const char *>(memchr(data_ + pos, '\n', size_ - pos));
+
+      if (nl)
+        end = size_t(nl - data_) + 1;
+    }
+
+    Chunk chunk;
+
+    chunk.begin = begin;
+    chunk.end   = end;
+
+    chunks.push_back(std::move(chunk));
+
+    begin = end;
+  }
+
+  //---
+
+  if (chunks.size() > 1) {
+    CDiffThreadPool pool(int(chunks.size()));
+
+    CDiffThreadPool::Tasks tasks;
+
+    for (auto &chunk : chunks)
+      tasks.push_back([this, &chunk]() { indexChunk(chunk); });
+
+    pool.run(tasks);
+  }
+  else {
+    for (auto &chunk : chunks)
+      indexChunk(chunk);
+  }
+
+  //---
+
+  // join chunk indices
+  size_t numLines = 0;
+
+  for (const auto &chunk : chunks)
+    numLines += chunk.starts.size();
+
+  offsets_.clear();
+  hashes_ .clear();
+
+  offsets_.reserve(numLines + 1);
+  hashes_ .reserve(numLines);
+
+  for (auto &chunk : chunks) {
+    offsets_.insert(offsets_.end(), chunk.starts.begin(), chunk.starts.end());
+    hashes_ .insert(hashes_ .end(), chunk.hashes.begin(), chunk.hashes.end());
+
+    numCRLF_ += chunk.numCRLF;
+
+    maxColumns_ = std::max(maxColumns_, chunk.maxColumns);
+
+    Offsets().swap(chunk.starts);
+    Hashes ().swap(chunk.hashes);
+  }
+
+  // end of last line (past implied newline if missing)
+  bool lastNewline = (size_ == 0 || data_[size_ - 1] == '\n');
+
+  offsets_.push_back(lastNewline ? size_ : size_ + 1);
+}
+
+void
+CDiffFile::
+indexChunk(Chunk &chunk) const
+{
+  // guess of 32 bytes per line
+  chunk.starts.reserve((chunk.end - chunk.begin)/32 + 1);
+  chunk.hashes.reserve((chunk.end - chunk.begin)/32 + 1);
+
+  size_t lineStart = chunk.begin;
+
+  // line has tabs or non ascii chars (columns differ from bytes)
+  bool lineSpecial = false;
+
+  auto addLine = [&](size_t lineEnd) {
+    size_t len = lineEnd - lineStart;
+
+    chunk.starts.push_back(lineStart);
+    chunk.hashes.push_back(CDiffLineTable::hashLine(data_ + lineStart, len));
+
+    std::string_view line(data_ + lineStart, len);
+
+    if (len > 0 && line.back() == '\r')
+      line.remove_suffix(1);
+
+    int lineColumns = (lineSpecial ? columns(line) : int(line.size()));
+
+    chunk.maxColumns = std::max(chunk.maxColumns, lineColumns);
+
+    lineSpecial = false;
+  };
+
+  // find newlines 64 bytes at a time and hash each line while it is in cache
+  for (size_t pos = chunk.begin; pos < chunk.end; pos += 64) {
+    size_t n = chunk.end - pos;
+
+    uint64_t mask    = CDiffSimd::byteMask(data_ + pos, n, '\n');
+    uint64_t special = CDiffSimd::byteMask(data_ + pos, n, '\t') |
+                       CDiffSimd::highMask(data_ + pos, n);
+
+    while (mask) {
+      int bit = __builtin_ctzll(mask);
+
+      size_t nl = pos + size_t(bit);
+
+      mask &= mask - 1;
+
+      // special bytes before newline are in this line
+      uint64_t lineBits = (uint64_t(1) << bit) - 1;
+
+      if (special & lineBits)
+        lineSpecial = true;
+
+      special &= ~lineBits;
+
+      addLine(nl);
+
+      if (nl > lineStart && data_[nl - 1] == '\r')
+        ++chunk.numCRLF;
+
+      lineStart = nl + 1;
+    }
+
+    // rest of block is in next line
+    if (special)
+      lineSpecial = true;
+  }
+
+  // last line has no newline
+  if (lineStart < chunk.end)
+    addLine(chunk.end);
+}
+
+int
+CDiffFile::
+columns(const std::string_view &str)
+{
+  int col = 0;
+
+  size_t pos = 0;
+  size_t len = str.size();
+
+  while (pos < len) {
+    auto c = static_cast<unsigned char>(str[pos]);
+
+    // ascii
+    if (c < 0x80) {
+      ++pos;
+
+      if (c == '\t')
+        col = (col/tabWidth() + 1)*tabWidth();
+      else
+        ++col;
+    }
+    else
+      col += charColumns(decodeChar(str, pos));
+  }
+
+  return col;
+}
+
+int
+CDiffFile::
+charColumns(uint32_t c)
+{
+  // combining and zero width
+  if ((c >= 0x0300 && c <= 0x036F) || (c >= 0x200B && c <= 0x200F) ||
+      (c >= 0x20D0 && c <= 0x20FF) || (c >= 0xFE20 && c <= 0xFE2F))
+    return 0;
+
+  // east asian wide and emoji
+  if ((c >= 0x1100  && c <= 0x115F ) || (c >= 0x2E80  && c <= 0xA4CF ) ||
+      (c >= 0xAC00  && c <= 0xD7A3 ) || (c >= 0xF900  && c <= 0xFAFF ) ||
+      (c >= 0xFE30  && c <= 0xFE4F ) || (c >= 0xFF00  && c <= 0xFF60 ) ||
+      (c >= 0xFFE0  && c <= 0xFFE6 ) || (c >= 0x1F300 && c <= 0x1F64F) ||
+      (c >= 0x1F900 && c <= 0x1F9FF) || (c >= 0x20000 && c <= 0x3FFFD))
+    return 2;
+
+  return 1;
+}
+
+uint32_t
+CDiffFile::
+decodeChar(const std::string_view &str, size_t &pos)
+{
+  auto c = static_cast<unsigned char>(str[pos++]);
+
+  if (c < 0x80)
+    return c;
+
+  int      n = 0;
+  uint32_t u = 0;
+
+  if      ((c & 0xE0) == 0xC0) { n = 1; u = c & 0x1F; }
+  else if ((c & 0xF0) == 0xE0) { n = 2; u = c & 0x0F; }
+  else if ((c & 0xF8) == 0xF0) { n = 3; u = c & 0x07; }
+  else                         { return c; } // invalid lead byte
+
+  size_t pos1 = pos;
+
+  for (int i = 0; i < n; ++i, ++pos1) {
+    if (pos1 >= str.size())
+      return c;
+
+    auto c1 = static_cast<unsigned char>(str[pos1]);
+
+    // invalid continuation byte
+    if ((c1 & 0xC0) != 0x80)
+      return c;
+
+    u = (u << 6) | (c1 & 0x3F);
+  }
+
+  pos = pos1;
+
+  return u;
+}
@@ -0,0 +1,139 @@
+#ifndef CDiffFile_H
+#define CDiffFile_H
+
+#include <CDiffColumnIndex.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// Read only memory mapped file with an index of line start offsets and line hashes.
+// Lines are returned as views of the mapped data (without the terminating newline).
+// A file which may be rewritten in place while its lines are used (the mapped pages
+// would change or fault with SIGBUS if truncated) can be read into memory instead.
+// The index is built in one pass (vectorized newline search with each line hashed as
+// it is found), large files are split into chunks indexed in parallel.
+class CDiffFile {
+ public:
+  CDiffFile();
+ ~CDiffFile();
+
+  CDiffFile(const CDiffFile &) = delete;
+  CDiffFile &operator=(const CDiffFile &) = delete;
+
+  // read file into memory instead of mapping it (used by next open)
+  bool isCopy() const { return copy_; }
+  void setCopy(bool b) { copy_ = b; }
+
+  // map (or read) file and build line index (returns false if file can't be read)
+  bool open(const std::string &fileName, int numThreads=1);
+
+  void close();
+
+  const std::string &fileName() const { return fileName_; }
+
+  // data is mapped from file
+  bool isMapped() const { return mapped_; }
+
+  const char *data() const { return data_; }
+  size_t      size() const { return size_; }
+
+  int numLines() const { return int(offsets_.size()) - 1; }
+
+  std::string_view line(int i) const {
+    uint64_t start = offsets_[size_t(i)];
+    uint64_t end   = offsets_[size_t(i) + 1] - 1;
+
+    return std::string_view(data_ + start, size_t(end - start));
+  }
+
+  // line without carriage return of \r\n terminator (for display)
+  std::string_view text(int i) const {
+    auto str = line(i);
+
+    if (! str.empty() && str.back() == '\r')
+      str.remove_suffix(1);
+
+    return str;
+  }
+
+  // bytes in line (without newline)
+  size_t lineSize(int i) const {
+    return size_t(offsets_[size_t(i) + 1] - offsets_[size_t(i)] - 1);
+  }
+
+  // hash of line (CDiffLineTable::hashLine)
+  uint64_t hash(int i) const { return hashes_[size_t(i)]; }
+
+  // number of leading and trailing lines which are the same in both files. Lines are
+  // compared by index (hash and size) only, as the mapped data of a file rewritten in
+  // place may already be changed.
+  static void commonLines(const CDiffFile &file1, const CDiffFile &file2,
+                          int &prefix, int &suffix);
+
+  // number of lines ending in \r\n
+  int numCRLF() const { return numCRLF_; }
+
+  // maximum display columns of lines
+  int maxColumns() const { return maxColumns_; }
+
+  // display columns of string (tabs advance to next tab stop, wide characters are two
+  // columns, combining characters are zero columns)
+  static int columns(const std::string_view &str);
+
+  // display columns of unicode character
+  static int charColumns(uint32_t c);
+
+  // decode utf-8 character at pos (advanced past character), invalid bytes are
+  // returned as one character
+  static uint32_t decodeChar(const std::string_view &str, size_t &pos);
+
+  static int tabWidth() { return 8; }
+
+  // byte position in text of line of first char ending after column col (startCol set
+  // to column of char). Long lines use a column index built on first use.
+  size_t columnPos(int i, int col, int &startCol) const;
+
+  // files smaller than this are indexed by one thread
+  static size_t minChunkSize() { return 4*1024*1024; }
+
+ private:
+  using Offsets = std::vector<uint64_t>;
+  using Hashes  = std::vector<uint64_t>;
+
+  struct Chunk {
+    size_t  begin   { 0 };
+    size_t  end     { 0 };
+    Offsets starts;
+    Hashes  hashes;
+    int     numCRLF    { 0 };
+    int     maxColumns { 0 };
+  };
+
+  void indexLines(int numThreads);
+  void indexChunk(Chunk &chunk) const;
+
+  using ColumnIndexP = std::unique_ptr<CDiffColumnIndex>;
+  using ColumnIndices = std::map<int, ColumnIndexP>;
+
+ private:
+  std::string fileName_;
+  bool        copy_    { false };
+  bool        mapped_  { false };
+  std::string buffer_;           // data read into memory (copy)
+  const char* data_    { nullptr };
+  size_t      size_    { 0 };
+  Offsets     offsets_ { 0 }; // line starts, last entry is one past end of last line
+  Hashes      hashes_;
+  int         numCRLF_    { 0 };
+  int         maxColumns_ { 0 };
+
+  // column indices of long lines (lazily built, can be used from draw threads)
+  mutable std::mutex    columnMutex_;
+  mutable ColumnIndices columnIndices_;
+};
+
+#endif
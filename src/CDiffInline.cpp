@@ -0,0 +1,116 @@
+#include <CDiffInline.h>
+#include <CDiffEngine.h>
+#include <CDiffFile.h>
+
+namespace {
+
+enum class CharType {
+  WORD,
+  SPACE,
+  OTHER
+};
+
+CharType charType(unsigned char c) {
+  if (isalnum(c) || c == '_' || c >= 0x80) return CharType::WORD;
+  if (isspace(c))                          return CharType::SPACE;
+
+  return CharType::OTHER;
+}
+
+}
+
+//------
+
+bool
+CDiffInline::
+diffLines(const std::string_view &lstr, const std::string_view &rstr, Mode mode,
+          Spans &lspans, Spans &rspans)
+{
+  lspans.clear();
+  rspans.clear();
+
+  if (lstr.size() > maxLineSize() || rstr.size() > maxLineSize())
+    return false;
+
+  Tokens ltokens, rtokens;
+
+  tokenize(lstr, mode, ltokens);
+  tokenize(rstr, mode, rtokens);
+
+  // intern tokens so they can be diffed as ids
+  CDiffLineTable tokenTable;
+
+  CDiffEngine::Ids lids, rids;
+
+  lids.reserve(ltokens.size());
+  rids.reserve(rtokens.size());
+
+  for (const auto &token : ltokens)
+    lids.push_back(tokenTable.add(lstr.substr(size_t(token.start), size_t(token.len))));
+
+  for (const auto &token : rtokens)
+    rids.push_back(tokenTable.add(rstr.substr(size_t(token.start), size_t(token.len))));
+
+  CDiffEngine engine;
+
+  engine.setLineTable(&tokenTable);
+
+  // keep search state of long lines small (many pairs are diffed per change)
+  engine.setMaxTraceBytes(maxTraceBytes());
+
+  CDiffEngine::Hunks hunks;
+
+  engine.exec(lids, rids, hunks);
+
+  //---
+
+  // span of changed tokens [i1, i2) (hunks are 1-based)
+  auto addSpan = [](const Tokens &tokens, int i1, int i2, Spans &spans) {
+    if (i1 >= i2)
+      return;
+
+    int start = tokens[size_t(i1)].start;
+    int end   = tokens[size_t(i2 - 1)].start + tokens[size_t(i2 - 1)].len;
+
+    spans.push_back(Span(start, end - start));
+  };
+
+  for (const auto &hunk : hunks) {
+    if (hunk.c != 'a')
+      addSpan(ltokens, hunk.lstart - 1, hunk.lend, lspans);
+
+    if (hunk.c != 'd')
+      addSpan(rtokens, hunk.rstart - 1, hunk.rend, rspans);
+  }
+
+  return true;
+}
+
+void
+CDiffInline::
+tokenize(const std::string_view &str, Mode mode, Tokens &tokens)
+{
+  size_t pos = 0;
+  size_t len = str.size();
+
+  while (pos < len) {
+    size_t start = pos;
+
+    if (mode == Mode::CHAR) {
+      (void) CDiffFile::decodeChar(str, pos);
+    }
+    else {
+      auto type = charType(static_cast<unsigned char>(str[pos]));
+
+      ++pos;
+
+      // words and space are runs of chars of the same type
+      if (type != CharType::OTHER) {
+        while (pos < len && charType(static_cast<unsigned char>(str[pos])) == type)
+          ++pos;
+      }
+    }
+
+    tokens.push_back(Span(int(start), int(pos - start)));
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef CDiffInline_H
+#define CDiffInline_H
+
+#include <string_view>
+#include <vector>
+
+// Intra line differences of a pair of changed lines. Each line is split into tokens
+// (words, runs of space and single other chars or single utf-8 chars), the token ids
+// are diffed and the changed tokens of each line are returned as byte spans.
+class CDiffInline {
+ public:
+  enum class Mode {
+    WORD,
+    CHAR
+  };
+
+  // changed bytes of line
+  struct Span {
+    int start { 0 };
+    int len   { 0 };
+
+    Span(int start1=0, int len1=0) : start(start1), len(len1) { }
+  };
+
+  using Spans = std::vector<Span>;
+
+ public:
+  // diff lines (returns false if either line is too long)
+  static bool diffLines(const std::string_view &lstr, const std::string_view &rstr,
+                        Mode mode, Spans &lspans, Spans &rspans);
+
+  // lines longer than this are not diffed
+  static size_t maxLineSize() { return 4096; }
+
+  // maximum bytes of diff search state per line pair (linear space diff above this)
+  static size_t maxTraceBytes() { return 64*1024; }
+
+ private:
+  using Tokens = std::vector<Span>;
+
+  static void tokenize(const std::string_view &str, Mode mode, Tokens &tokens);
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include <CDiffLineTable.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+inline uint64_t mix(uint64_t h) {
+  h ^= h >> 33; h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+
+  return h;
+}
+
+}
+
+//------
+
+CDiffLineTable::
+CDiffLineTable()
+{
+}
+
+void
+CDiffLineTable::
+clear()
+{
+  lines_  .clear();
+  hashes_ .clear();
+  buckets_.clear();
+  strings_.clear();
+}
+
+CDiffLineTable::Id
+CDiffLineTable::
+add(const std::string_view &line)
+{
+  return add(line, hashLine(line.data(), line.size()));
+}
+
+CDiffLineTable::Id
+CDiffLineTable::
+add(const std::string_view &line, uint64_t hash)
+{
+  uint bucket;
+
+  Id id = find(line, hash, bucket);
+
+  if (id != noId)
+    return id;
+
+  return addNew(line, hash, bucket);
+}
+
+CDiffLineTable::Id
+CDiffLineTable::
+addCopy(const std::string &line)
+{
+  uint64_t hash = hashLine(line.data(), line.size());
+
+  uint bucket;
+
+  Id id = find(line, hash, bucket);
+
+  if (id != noId)
+    return id;
+
+  // deque elements are not moved so the view stays valid
+  strings_.push_back(line);
+
+  return addNew(strings_.back(), hash, bucket);
+}
+
+CDiffLineTable::Id
+CDiffLineTable::
+find(const std::string_view &line, uint64_t hash, uint &bucket) const
+{
+  bucket = 0;
+
+  if (buckets_.empty())
+    return noId;
+
+  uint mask = uint(buckets_.size() - 1);
+
+  for (bucket = uint(hash) & mask; ; bucket = (bucket + 1) & mask) {
+    Id id = buckets_[bucket];
+
+    if (id == noId)
+      return noId;
+
+    if (hashes_[id] == hash && lines_[id] == line)
+      return id;
+  }
+}
+
+CDiffLineTable::Id
+CDiffLineTable::
+addNew(const std::string_view &line, uint64_t hash, uint bucket)
+{
+  Id id = Id(lines_.size());
+
+  lines_ .push_back(line);
+  hashes_.push_back(hash);
+
+  // keep load factor below 1/2
+  if (2*lines_.size() > buckets_.size())
+    rehash();
+  else
+    buckets_[bucket] = id;
+
+  return id;
+}
+
+void
+CDiffLineTable::
+rehash()
+{
+  size_t n = std::max(size_t(1024), 4*lines_.size());
+
+  size_t nb = 1;
+
+  while (nb < n)
+    nb <<= 1;
+
+  buckets_.assign(nb, noId);
+
+  uint mask = uint(nb - 1);
+
+  for (Id id = 0; id < Id(lines_.size()); ++id) {
+    uint bucket = uint(hashes_[id]) & mask;
+
+    while (buckets_[bucket] != noId)
+      bucket = (bucket + 1) & mask;
+
+    buckets_[bucket] = id;
+  }
+}
+
+// 64-bit hash of line bytes (8 bytes per step with final avalanche)
+uint64_t
+CDiffLineTable::
+hashLine(const char *str, size_t len)
+{
+  uint64_t h = 0x9e3779b97f4a7c15ULL ^ (len*0xc2b2ae3d27d4eb4fULL);
+
+  size_t i = 0;
+
+  for ( ; i + 8 <= len; i += 8) {
+    uint64_t w;
+
+    memcpy(&w, str + i, 8);
+
+    h = (h ^ mix(w))*0x9fb21c651e98df25ULL;
+  }
+
+  if (i < len) {
+    uint64_t w = 0;
+
+    memcpy(&w, str + i, len - i);
+
+    h = (h ^ mix(w))*0x9fb21c651e98df25ULL;
+  }
+
+  return mix(h);
+}
@@ -0,0 +1,59 @@
+#ifndef CDiffLineTable_H
+#define CDiffLineTable_H
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// Table of distinct lines shared by both sides of a diff. Each distinct line is stored
+// once and identified by an integer id (allocated in order) with a 64-bit hash, so
+// lines can be compared by id. Lines are views of the (mapped) file data, only
+// lines added with addCopy are owned by the table.
+class CDiffLineTable {
+ public:
+  using Id = uint;
+
+ public:
+  CDiffLineTable();
+
+  void clear();
+
+  // add line (if new) and return its id, line data must stay valid while in table
+  Id add(const std::string_view &line);
+
+  // add line with precomputed hash (hashLine)
+  Id add(const std::string_view &line, uint64_t hash);
+
+  // add copy of line (if new) and return its id
+  Id addCopy(const std::string &line);
+
+  uint size() const { return uint(lines_.size()); }
+
+  const std::string_view &line(Id id) const { return lines_[id]; }
+
+  uint64_t hash(Id id) const { return hashes_[id]; }
+
+  static uint64_t hashLine(const char *str, size_t len);
+
+ private:
+  Id   find(const std::string_view &line, uint64_t hash, uint &bucket) const;
+  Id   addNew(const std::string_view &line, uint64_t hash, uint bucket);
+  void rehash();
+
+ private:
+  using Lines   = std::vector<std::string_view>;
+  using Hashes  = std::vector<uint64_t>;
+  using Buckets = std::vector<Id>;
+  using Strings = std::deque<std::string>;
+
+  static constexpr Id noId = Id(-1);
+
+  Lines   lines_;
+  Hashes  hashes_;
+  Buckets buckets_; // open addressing (linear probe) hash table of ids
+  Strings strings_; // owned line data (addCopy)
+};
+
+#endif
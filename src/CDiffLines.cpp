@@ -0,0 +1,75 @@
+#include <CDiffLines.h>
+#include <CDiffEngine.h>
+
+CDiffLines::
+CDiffLines()
+{
+}
+
+bool
+CDiffLines::
+load(const std::string &lfileName, const std::string &rfileName, const Cancel *cancel)
+{
+  lineTable_.clear();
+
+  errorMsg_.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(normMutex_);
+
+    normIds_.clear();
+  }
+
+  if (! loadFile(lfileName, lfile_, lids_, cancel)) return false;
+  if (! loadFile(rfileName, rfile_, rids_, cancel)) return false;
+
+  return true;
+}
+
+bool
+CDiffLines::
+loadFile(const std::string &fileName, CDiffFile &file, Ids &ids, const Cancel *cancel)
+{
+  ids.clear();
+
+  file.setCopy(copyFiles_);
+
+  if (! file.open(fileName, numThreads_)) {
+    errorMsg_ = "Failed to read '" + fileName + "'";
+    return false;
+  }
+
+  int numLines = file.numLines();
+
+  ids.reserve(size_t(numLines));
+
+  for (int i = 0; i < numLines; ++i) {
+    if ((i & 0xffff) == 0 && cancel && cancel->load())
+      return false;
+
+    ids.push_back(lineTable_.add(file.line(i), file.hash(i)));
+  }
+
+  return true;
+}
+
+const CDiffLines::NormIds *
+CDiffLines::
+normIds(uint flags, const CDiffMask *mask, const Cancel *cancel) const
+{
+  std::lock_guard<std::mutex> lock(normMutex_);
+
+  auto &normIds = normIds_[NormKey(flags, mask ? mask->text() : "")];
+
+  if (! normIds) {
+    auto normIds1 = std::make_unique<NormIds>();
+
+    if (! CDiffEngine::normalizeIds(lineTable_, flags, mask, normIds1->ids,
+                                    normIds1->numIds, numThreads_, cancel))
+      return nullptr;
+
+    normIds = std::move(normIds1);
+  }
+
+  return normIds.get();
+}
@@ -0,0 +1,105 @@
+#ifndef CDiffLines_H
+#define CDiffLines_H
+
+#include <CDiffFile.h>
+#include <CDiffLineTable.h>
+#include <CDiffMask.h>
+#include <CSideType.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Lines of the two files being compared. Each file is memory mapped (or read into
+// memory) with an index of line offsets, the line text is interned (as views of the
+// file data) in a table shared by both files and each file is an array of line ids.
+class CDiffLines {
+ public:
+  using Id     = CDiffLineTable::Id;
+  using Ids    = std::vector<Id>;
+  using Cancel = std::atomic<bool>;
+
+  // map of line table id to normalized line id for a set of ignore flags
+  struct NormIds {
+    Ids ids;
+    Id  numIds { 0 };
+  };
+
+ public:
+  CDiffLines();
+
+  const CDiffLineTable &lineTable() const { return lineTable_; }
+
+  // threads used to index each file
+  int numThreads() const { return numThreads_; }
+  void setNumThreads(int n) { numThreads_ = n; }
+
+  // read files into memory instead of mapping them (needed if lines are kept while the
+  // files may be rewritten, mapping is only safe for short lived uses like benchmarks)
+  bool isCopyFiles() const { return copyFiles_; }
+  void setCopyFiles(bool b) { copyFiles_ = b; }
+
+  const CDiffFile &file(CSideType side) const {
+    return (side == CSIDE_TYPE_LEFT ? lfile_ : rfile_);
+  }
+
+  const std::string &fileName(CSideType side) const { return file(side).fileName(); }
+
+  const Ids &ids(CSideType side) const {
+    return (side == CSIDE_TYPE_LEFT ? lids_ : rids_);
+  }
+
+  int numLines(CSideType side) const { return int(ids(side).size()); }
+
+  // maximum display columns of lines (computed on load)
+  int maxColumns(CSideType side) const { return file(side).maxColumns(); }
+
+  std::string_view line(CSideType side, int i) const { return file(side).line(i); }
+
+  // line for display (no \r of \r\n)
+  std::string_view text(CSideType side, int i) const { return file(side).text(i); }
+
+  // byte position in text of first char ending after column col
+  size_t columnPos(CSideType side, int i, int col, int &startCol) const {
+    return file(side).columnPos(i, col, startCol);
+  }
+
+  // load both files (returns false if cancelled or a file can't be read)
+  bool load(const std::string &lfileName, const std::string &rfileName,
+            const Cancel *cancel=nullptr);
+
+  // reason last load failed (empty if cancelled)
+  const std::string &errorMsg() const { return errorMsg_; }
+
+  // normalized line ids for ignore flags (CDiffEngine::IgnoreFlags) and mask rules,
+  // computed on first use and cached so changing flags only needs the ids to be diffed
+  // (returns nullptr if cancelled)
+  const NormIds *normIds(uint flags, const CDiffMask *mask=nullptr,
+                         const Cancel *cancel=nullptr) const;
+
+ private:
+  bool loadFile(const std::string &fileName, CDiffFile &file, Ids &ids,
+                const Cancel *cancel);
+
+ private:
+  CDiffFile      lfile_;
+  CDiffFile      rfile_;
+  CDiffLineTable lineTable_;
+  Ids            lids_;
+  Ids            rids_;
+  int            numThreads_ { 1 };
+  bool           copyFiles_  { false };
+  std::string    errorMsg_;
+
+  using NormIdsP     = std::unique_ptr<NormIds>;
+  using NormKey      = std::pair<uint, std::string>; // flags and mask text
+  using FlagsNormIds = std::map<NormKey, NormIdsP>;
+
+  mutable std::mutex   normMutex_;
+  mutable FlagsNormIds normIds_;
+};
+
+#endif
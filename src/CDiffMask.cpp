@@ -0,0 +1,390 @@
+#include <CDiffMask.h>
+
+#include <cstring>
+#include <sstream>
+
+CDiffMask::
+CDiffMask()
+{
+}
+
+bool
+CDiffMask::
+setText(const std::string &text, std::string &msg)
+{
+  Rules         rules;
+  CompiledRules compiled;
+
+  std::istringstream is(text);
+
+  std::string line;
+
+  int lineNum = 0;
+
+  while (std::getline(is, line)) {
+    ++lineNum;
+
+    // strip leading space
+    auto pos = line.find_first_not_of(" \t");
+
+    if (pos == std::string::npos || line[pos] == '#')
+      continue;
+
+    line = line.substr(pos);
+
+    auto pos1 = line.find_first_of(" \t");
+
+    std::string type = line.substr(0, pos1);
+
+    Rule rule;
+
+    if      (type == "mask"  ) rule.type = Type::MASK;
+    else if (type == "ignore") rule.type = Type::IGNORE;
+    else {
+      msg = "line " + std::to_string(lineNum) + ": unknown rule type '" + type + "'";
+      return false;
+    }
+
+    auto pos2 = (pos1 != std::string::npos ? line.find_first_not_of(" \t", pos1) : pos1);
+
+    if (pos2 == std::string::npos) {
+      msg = "line " + std::to_string(lineNum) + ": missing pattern";
+      return false;
+    }
+
+    rule.pattern = line.substr(pos2);
+
+    CompiledRule crule;
+
+    crule.rule = rule;
+
+    try {
+      crule.regex = std::regex(rule.pattern, std::regex::ECMAScript | std::regex::optimize);
+    }
+    catch (const std::regex_error &e) {
+      msg = "line " + std::to_string(lineNum) + ": " + e.what();
+      return false;
+    }
+
+    crule.prefix = literalPrefix(rule.pattern);
+
+    if (crule.prefix.empty())
+      crule.required = requiredLiteral(rule.pattern);
+
+    rules   .push_back(rule);
+    compiled.push_back(std::move(crule));
+  }
+
+  rules_    = std::move(rules);
+  compiled_ = std::move(compiled);
+
+  return true;
+}
+
+std::string
+CDiffMask::
+text() const
+{
+  std::string text;
+
+  for (const auto &rule : rules_) {
+    text += (rule.type == Type::MASK ? "mask " : "ignore ");
+    text += rule.pattern;
+    text += "\n";
+  }
+
+  return text;
+}
+
+bool
+CDiffMask::
+apply(const std::string_view &str, std::string &str1) const
+{
+  if (str.size() > maxLineSize())
+    return false;
+
+  bool changed = false;
+
+  std::string_view line = str;
+
+  std::string str2;
+
+  for (const auto &crule : compiled_) {
+    // skip lines without literal prefix
+    size_t pos = 0;
+
+    if (! crule.prefix.empty()) {
+      pos = line.find(crule.prefix);
+
+      if (pos == std::string_view::npos)
+        continue;
+    }
+    else if (crule.required.size() == 1) {
+      if (! memchr(line.data(), crule.required[0], line.size()))
+        continue;
+    }
+    else if (! crule.required.empty()) {
+      if (! memmem(line.data(), line.size(), crule.required.data(), crule.required.size()))
+        continue;
+    }
+
+    const char *begin = line.data() + pos;
+    const char *end   = line.data() + line.size();
+
+    // chars before prefix are still used for \b, ^, etc
+    auto flags = (pos > 0 ? std::regex_constants::match_prev_avail :
+                            std::regex_constants::match_default);
+
+    if (crule.rule.type == Type::IGNORE) {
+      if (std::regex_search(begin, end, crule.regex, flags)) {
+        str1 = std::string(1, ignoreChar());
+        return true;
+      }
+
+      continue;
+    }
+
+    // replace each (non empty) match by mask char
+    str2.assign(line.data(), pos);
+
+    bool masked = false;
+
+    const char *last = begin;
+
+    for (std::cregex_iterator p(begin, end, crule.regex, flags), pe; p != pe; ++p) {
+      const auto &match = *p;
+
+      if (match.length(0) == 0)
+        continue;
+
+      str2.append(last, match[0].first);
+      str2 += maskChar();
+
+      last = match[0].second;
+
+      masked = true;
+    }
+
+    if (! masked)
+      continue;
+
+    str2.append(last, end);
+
+    str1.swap(str2);
+
+    line = str1;
+
+    changed = true;
+  }
+
+  return changed;
+}
+
+std::string
+CDiffMask::
+literalPrefix(const std::string &pattern)
+{
+  // alternation can start with anything
+  bool escaped = false;
+  int  depth   = 0;
+
+  for (auto c : pattern) {
+    if      (escaped)  escaped = false;
+    else if (c == '\\') escaped = true;
+    else if (c == '[') ++depth;
+    else if (c == ']') depth = std::max(depth - 1, 0);
+    else if (c == '|' && depth == 0) return "";
+  }
+
+  //---
+
+  std::string prefix;
+
+  size_t i   = 0;
+  size_t len = pattern.size();
+
+  while (i < len) {
+    char c = pattern[i];
+
+    char c1      = '\0';
+    bool literal = true;
+
+    if (c == '\\') {
+      if (i + 1 >= len)
+        break;
+
+      c1 = pattern[i + 1];
+
+      // escaped punctuation is literal, escaped letters/digits are classes etc
+      if (isalnum(static_cast<unsigned char>(c1)))
+        literal = false;
+      else
+        i += 2;
+    }
+    else if (strchr("^$.|?*+()[]{}", c)) {
+      literal = false;
+    }
+    else {
+      c1 = c;
+
+      ++i;
+    }
+
+    if (! literal)
+      break;
+
+    // char followed by quantifier is optional or repeated
+    if (i < len && strchr("?*{", pattern[i]))
+      break;
+
+    prefix += c1;
+
+    if (i < len && pattern[i] == '+')
+      break;
+  }
+
+  return prefix;
+}
+
+std::string
+CDiffMask::
+requiredLiteral(const std::string &pattern)
+{
+  std::string best, run;
+
+  auto endRun = [&]() {
+    if (run.size() > best.size())
+      best = run;
+
+    run.clear();
+  };
+
+  size_t i   = 0;
+  size_t len = pattern.size();
+
+  while (i < len) {
+    char c = pattern[i];
+
+    // next atom (literal char or skipped class/group/anchor)
+    char c1      = '\0';
+    bool literal = false;
+
+    if      (c == '\\') {
+      if (i + 1 >= len)
+        return "";
+
+      c1 = pattern[i + 1];
+
+      // escaped punctuation is literal, escaped letters/digits are classes etc
+      literal = ! isalnum(static_cast<unsigned char>(c1));
+
+      i += 2;
+    }
+    else if (c == '[') {
+      // skip class (']' first in class is literal)
+      size_t j = i + 1;
+
+      if (j < len && pattern[j] == '^') ++j;
+      if (j < len && pattern[j] == ']') ++j;
+
+      while (j < len && pattern[j] != ']')
+        j += (pattern[j] == '\\' ? 2 : 1);
+
+      i = j + 1;
+    }
+    else if (c == '(') {
+      // skip group (alternatives inside only affect the group)
+      int depth = 0;
+
+      while (i < len) {
+        if      (pattern[i] == '\\') ++i;
+        else if (pattern[i] == '(' ) ++depth;
+        else if (pattern[i] == ')' ) { if (--depth == 0) break; }
+
+        ++i;
+      }
+
+      ++i;
+    }
+    else if (c == '|') {
+      // top level alternation can match without any literal
+      return "";
+    }
+    else if (strchr("^$.)*+?{", c)) {
+      ++i;
+    }
+    else {
+      c1      = c;
+      literal = true;
+
+      ++i;
+    }
+
+    // quantifier (atom is optional if it can repeat zero times)
+    bool optional = false, repeated = false;
+
+    if (i < len) {
+      char q = pattern[i];
+
+      if      (q == '?' || q == '*') {
+        optional = true;
+
+        ++i;
+      }
+      else if (q == '+') {
+        repeated = true;
+
+        ++i;
+      }
+      else if (q == '{') {
+        size_t j = pattern.find('}', i);
+
+        if (j == std::string::npos)
+          j = len - 1;
+
+        optional = (i + 1 < len && pattern[i + 1] == '0');
+        repeated = true;
+
+        i = j + 1;
+      }
+
+      // lazy quantifier
+      if ((optional || repeated) && i < len && pattern[i] == '?')
+        ++i;
+    }
+
+    if (! literal || optional) {
+      endRun();
+      continue;
+    }
+
+    run += c1;
+
+    // char is required but the following text may be another copy of it
+    if (repeated)
+      endRun();
+  }
+
+  endRun();
+
+  return best;
+}
+
+const CDiffMask::Presets &
+CDiffMask::
+presets()
+{
+  static Presets presets = {
+    { "Timestamps",
+      "mask [0-9]{4}-[0-9]{2}-[0-9]{2}[T ][0-9]{2}:[0-9]{2}:[0-9]{2}([.,][0-9]+)?"
+      "(Z|[+-][0-9]{2}:?[0-9]{2})?\n"
+      "mask [0-9]{2}:[0-9]{2}:[0-9]{2}([.,][0-9]+)?\n" },
+    { "PIDs",
+      "mask pid[=: ]*[0-9]+\n"
+      "mask \\[[0-9]+\\]\n" },
+    { "UUIDs",
+      "mask [0-9a-fA-F]{8}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{12}\n" },
+  };
+
+  return presets;
+}
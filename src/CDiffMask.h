@@ -0,0 +1,88 @@
+#ifndef CDiffMask_H
+#define CDiffMask_H
+
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Regular expression rules applied to each line before lines are compared. A mask rule
+// replaces matched text by a mask character so e.g. timestamps, PIDs or UUIDs don't
+// cause differences. An ignore rule makes any line it matches compare equal to any
+// other ignored line. Rules are only run on lines containing the literal prefix of
+// the pattern (if any) and matching starts at the first occurrence of the prefix.
+// Patterns without a prefix are still skipped for lines without a literal which every
+// match must contain (e.g. the '-' of a date or UUID). Lines longer than maxLineSize()
+// are not matched by any rule (they are compared unmasked) so a huge line can't make
+// the regex engine slow or overflow its stack.
+//
+// Rules are written one per line as "mask <regex>" or "ignore <regex>" (ECMAScript
+// syntax), empty lines and lines starting with '#' are skipped.
+class CDiffMask {
+ public:
+  enum class Type {
+    MASK,
+    IGNORE
+  };
+
+  struct Rule {
+    Type        type { Type::MASK };
+    std::string pattern;
+  };
+
+  using Rules = std::vector<Rule>;
+
+  // named rules text
+  struct Preset {
+    std::string name;
+    std::string text;
+  };
+
+  using Presets = std::vector<Preset>;
+
+ public:
+  CDiffMask();
+
+  bool empty() const { return rules_.empty(); }
+
+  const Rules &rules() const { return rules_; }
+
+  // set rules from text (returns false and sets msg if text is invalid)
+  bool setText(const std::string &text, std::string &msg);
+
+  // rules as text
+  std::string text() const;
+
+  // apply rules to line (returns false if unchanged)
+  bool apply(const std::string_view &str, std::string &str1) const;
+
+  // literal text which must start any match of pattern (empty if none)
+  static std::string literalPrefix(const std::string &pattern);
+
+  // longest literal text which must be in any match of pattern (empty if none)
+  static std::string requiredLiteral(const std::string &pattern);
+
+  // lines longer than this are not matched
+  static size_t maxLineSize() { return 4096; }
+
+  // builtin presets
+  static const Presets &presets();
+
+  static char maskChar  () { return '\x1f'; }
+  static char ignoreChar() { return '\x1e'; }
+
+ private:
+  struct CompiledRule {
+    Rule        rule;
+    std::regex  regex;
+    std::string prefix;
+    std::string required; // literal in every match (if no prefix)
+  };
+
+  using CompiledRules = std::vector<CompiledRule>;
+
+  Rules         rules_;
+  CompiledRules compiled_;
+};
+
+#endif
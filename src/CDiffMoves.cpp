@@ -0,0 +1,244 @@
+#include <CDiffMoves.h>
+#include <CDiffChanges.h>
+
+#include <algorithm>
+#include <unordered_map>
+
+CDiffMoves::
+CDiffMoves()
+{
+}
+
+void
+CDiffMoves::
+clear()
+{
+  moves_ .clear();
+  lorder_.clear();
+}
+
+bool
+CDiffMoves::
+find(const CDiffChanges &changes, const Ids &lids, const Ids &rids,
+     const Ids *normIds, const Cancel *cancel)
+{
+  clear();
+
+  int n = minLines();
+
+  auto lid = [&](int i) { return (normIds ? (*normIds)[lids[size_t(i)]] : lids[size_t(i)]); };
+  auto rid = [&](int i) { return (normIds ? (*normIds)[rids[size_t(i)]] : rids[size_t(i)]); };
+
+  // polynomial hash of n ids (oldest id has highest power)
+  const uint64_t base = 0x100000001B3ULL;
+
+  uint64_t basePow = 1; // base^(n - 1)
+
+  for (int k = 1; k < n; ++k)
+    basePow *= base;
+
+  auto hashWindow = [&](const auto &id, int i) {
+    uint64_t h = 0;
+
+    for (int k = 0; k < n; ++k)
+      h = h*base + id(i + k);
+
+    return h;
+  };
+
+  auto rollWindow = [&](const auto &id, uint64_t h, int i) {
+    // remove line i - 1 and add line i + n - 1
+    return (h - uint64_t(id(i - 1))*basePow)*base + id(i + n - 1);
+  };
+
+  // windows of one repeated line (e.g. blank lines) aren't moves
+  auto isUniform = [&](const auto &id, int i) {
+    for (int k = 1; k < n; ++k)
+      if (id(i + k) != id(i))
+        return false;
+
+    return true;
+  };
+
+  //---
+
+  // index windows of deleted lines (head is last window with hash, next links to
+  // previous window with same hash)
+  std::unordered_map<uint64_t, int> heads;
+
+  Inds lnext(lids.size(), -1);
+
+  for (int c = 0; c < changes.size(); ++c) {
+    int first = changes.first(CSIDE_TYPE_LEFT, c);
+    int last  = first + changes.len(CSIDE_TYPE_LEFT, c) - n;
+
+    uint64_t h = 0;
+
+    for (int i = first; i <= last; ++i) {
+      h = (i == first ? hashWindow(lid, i) : rollWindow(lid, h, i));
+
+      if (isUniform(lid, i))
+        continue;
+
+      auto p = heads.find(h);
+
+      if (p != heads.end()) {
+        lnext[size_t(i)] = (*p).second;
+
+        (*p).second = i;
+      }
+      else
+        heads[h] = i;
+    }
+
+    if (cancel && *cancel)
+      return false;
+  }
+
+  if (heads.empty())
+    return true;
+
+  //---
+
+  // look up windows of added lines and extend longest unused match
+  std::vector<bool> lused(lids.size());
+
+  for (int c = 0; c < changes.size(); ++c) {
+    int first = changes.first(CSIDE_TYPE_RIGHT, c);
+    int end   = first + changes.len(CSIDE_TYPE_RIGHT, c);
+
+    uint64_t h = 0;
+
+    int hashLine = -1; // line of window hash h
+
+    for (int i = first; i + n <= end; ) {
+      h = (hashLine == i - 1 ? rollWindow(rid, h, i) : hashWindow(rid, i));
+
+      hashLine = i;
+
+      auto p = heads.find(h);
+
+      if (p == heads.end() || isUniform(rid, i)) {
+        ++i;
+        continue;
+      }
+
+      int bestLine = -1, bestLen = 0, bestChange = -1;
+
+      int numCandidates = 0;
+
+      for (int j = (*p).second; j >= 0 && numCandidates < maxCandidates();
+           j = lnext[size_t(j)], ++numCandidates) {
+        int lc = changes.lineChange(CSIDE_TYPE_LEFT, j);
+
+        int lend = changes.first(CSIDE_TYPE_LEFT, lc) + changes.len(CSIDE_TYPE_LEFT, lc);
+
+        // lines of same change aren't moved
+        if (lc == c || j + n > lend)
+          continue;
+
+        int len = 0;
+
+        while (i + len < end && j + len < lend && ! lused[size_t(j + len)] &&
+               rid(i + len) == lid(j + len))
+          ++len;
+
+        if (len >= n && len > bestLen) {
+          bestLine   = j;
+          bestLen    = len;
+          bestChange = lc;
+        }
+      }
+
+      if (bestLine < 0) {
+        ++i;
+        continue;
+      }
+
+      Move move;
+
+      move.lfirst  = bestLine;
+      move.rfirst  = i;
+      move.len     = bestLen;
+      move.lchange = bestChange;
+      move.rchange = c;
+
+      moves_.push_back(move);
+
+      for (int k = 0; k < bestLen; ++k)
+        lused[size_t(bestLine + k)] = true;
+
+      i += bestLen;
+    }
+
+    if (cancel && *cancel)
+      return false;
+  }
+
+  //---
+
+  lorder_.resize(moves_.size());
+
+  for (size_t i = 0; i < moves_.size(); ++i)
+    lorder_[i] = int(i);
+
+  std::sort(lorder_.begin(), lorder_.end(), [&](int i1, int i2) {
+    return moves_[size_t(i1)].lfirst < moves_[size_t(i2)].lfirst; });
+
+  return true;
+}
+
+int
+CDiffMoves::
+lineMove(CSideType side, int line) const
+{
+  // last move starting at or before line
+  int i = -1;
+
+  if (side == CSIDE_TYPE_LEFT) {
+    auto p = std::upper_bound(lorder_.begin(), lorder_.end(), line, [&](int l, int i1) {
+      return l < moves_[size_t(i1)].lfirst; });
+
+    if (p != lorder_.begin())
+      i = *(p - 1);
+  }
+  else {
+    auto p = std::upper_bound(moves_.begin(), moves_.end(), line, [](int l, const Move &m) {
+      return l < m.rfirst; });
+
+    if (p != moves_.begin())
+      i = int(p - moves_.begin()) - 1;
+  }
+
+  if (i < 0)
+    return -1;
+
+  const auto &move = moves_[size_t(i)];
+
+  int first = (side == CSIDE_TYPE_LEFT ? move.lfirst : move.rfirst);
+
+  return (line < first + move.len ? i : -1);
+}
+
+int
+CDiffMoves::
+changeMove(CSideType side, int change) const
+{
+  // moves are in change order on each side
+  if (side == CSIDE_TYPE_LEFT) {
+    auto p = std::lower_bound(lorder_.begin(), lorder_.end(), change, [&](int i1, int c) {
+      return moves_[size_t(i1)].lchange < c; });
+
+    if (p != lorder_.end() && moves_[size_t(*p)].lchange == change)
+      return *p;
+  }
+  else {
+    auto p = std::lower_bound(moves_.begin(), moves_.end(), change, [](const Move &m, int c) {
+      return m.rchange < c; });
+
+    if (p != moves_.end() && (*p).rchange == change)
+      return int(p - moves_.begin());
+  }
+
+  return -1;
+}
@@ -0,0 +1,67 @@
+#ifndef CDiffMoves_H
+#define CDiffMoves_H
+
+#include <CSideType.h>
+#include <CDiffLineTable.h>
+#include <atomic>
+#include <vector>
+
+class CDiffChanges;
+
+// Blocks of deleted lines which are added elsewhere (moved). Windows of minLines()
+// deleted (left) lines are indexed by a rolling hash of their line ids, windows of
+// added (right) lines are looked up and matches are extended while the following
+// lines are equal. Each move links the changes of its two locations. Time is linear
+// in the number of changed lines (candidates per window are limited).
+class CDiffMoves {
+ public:
+  using Id     = CDiffLineTable::Id;
+  using Ids    = std::vector<Id>;
+  using Cancel = std::atomic<bool>;
+
+  struct Move {
+    int lfirst  { 0 }; // first left line (0-based)
+    int rfirst  { 0 }; // first right line (0-based)
+    int len     { 0 }; // number of lines
+    int lchange { 0 }; // change containing left lines
+    int rchange { 0 }; // change containing right lines
+  };
+
+ public:
+  CDiffMoves();
+
+  void clear();
+
+  int size() const { return int(moves_.size()); }
+
+  bool empty() const { return moves_.empty(); }
+
+  // moves are in right line order
+  const Move &move(int i) const { return moves_[size_t(i)]; }
+
+  // find moves between changes (line i has id ids[i], or normIds[ids[i]] if set)
+  // (returns false if cancelled)
+  bool find(const CDiffChanges &changes, const Ids &lids, const Ids &rids,
+            const Ids *normIds=nullptr, const Cancel *cancel=nullptr);
+
+  // move containing line of side (-1 if none)
+  int lineMove(CSideType side, int line) const;
+
+  // first move with lines in change of side (-1 if none)
+  int changeMove(CSideType side, int change) const;
+
+  // minimum lines in moved block
+  static int minLines() { return 3; }
+
+  // maximum earlier blocks with same hash compared for each window
+  static int maxCandidates() { return 16; }
+
+ private:
+  using Moves = std::vector<Move>;
+  using Inds  = std::vector<int>;
+
+  Moves moves_;
+  Inds  lorder_; // move indices in left line order
+};
+
+#endif
@@ -0,0 +1,119 @@
+#include <CDiffRows.h>
+
+#include <algorithm>
+
+CDiffRows::
+CDiffRows()
+{
+}
+
+void
+CDiffRows::
+reset(const CDiffChanges *changes, int lnumLines, int rnumLines)
+{
+  changes_   = changes;
+  lnumLines_ = lnumLines;
+  rnumLines_ = rnumLines;
+
+  rows_.clear();
+}
+
+void
+CDiffRows::
+update()
+{
+  if (! changes_)
+    return;
+
+  int n = changes_->size();
+
+  // lines between last change and each change are aligned so row can be found from
+  // either side
+  for (int i = numChanges(); i < n; ++i)
+    rows_.push_back(lineRow(CSIDE_TYPE_LEFT, changes_->first(CSIDE_TYPE_LEFT, i)));
+}
+
+int
+CDiffRows::
+numRows() const
+{
+  return std::max(lineRow(CSIDE_TYPE_LEFT , lnumLines_),
+                  lineRow(CSIDE_TYPE_RIGHT, rnumLines_));
+}
+
+int
+CDiffRows::
+lineRow(CSideType side, int line) const
+{
+  int i = lineChange(side, line);
+
+  if (i < 0)
+    return line;
+
+  int first = changes_->first(side, i);
+  int len   = changes_->len  (side, i);
+
+  int offset = line - first;
+
+  // line in change
+  if (offset < len)
+    return changeRow(i) + offset;
+
+  // line after change (skip padding)
+  return changeRow(i) + changeNumRows(i) + offset - len;
+}
+
+CDiffRows::Row
+CDiffRows::
+rowLine(CSideType side, int row) const
+{
+  Row rowLine;
+
+  int i = rowChange(row);
+
+  if (i < 0) {
+    rowLine.line = row;
+  }
+  else {
+    int first = changes_->first(side, i);
+    int len   = changes_->len  (side, i);
+    int rows  = changeNumRows(i);
+
+    int offset = row - changeRow(i);
+
+    if      (offset < len) {
+      rowLine.line   = first + offset;
+      rowLine.change = i;
+    }
+    else if (offset < rows) {
+      rowLine.change = i;
+    }
+    else
+      rowLine.line = first + len + offset - rows;
+  }
+
+  if (rowLine.line >= numLines(side))
+    rowLine.line = -1;
+
+  return rowLine;
+}
+
+int
+CDiffRows::
+lineChange(CSideType side, int line) const
+{
+  if (! changes_)
+    return -1;
+
+  // only changes with rows
+  return std::min(changes_->lineChange(side, line), numChanges() - 1);
+}
+
+int
+CDiffRows::
+rowChange(int row) const
+{
+  auto p = std::upper_bound(rows_.begin(), rows_.end(), row);
+
+  return int(p - rows_.begin()) - 1;
+}
@@ -0,0 +1,66 @@
+#ifndef CDiffRows_H
+#define CDiffRows_H
+
+#include <CDiffChanges.h>
+#include <CSideType.h>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+// Aligned display rows of the two files. Each change occupies the same rows on both
+// sides (the larger of its line counts), the side with fewer lines is padded after
+// its changed lines. Only the first row of each change is stored (lines come from the
+// change table) and rows and lines are mapped using a binary search of the changes.
+class CDiffRows {
+ public:
+  // line (0-based, -1 if padding) and change index (-1 if none) of row
+  struct Row {
+    int line   { -1 };
+    int change { -1 };
+  };
+
+ public:
+  CDiffRows();
+
+  void reset(const CDiffChanges *changes, int lnumLines, int rnumLines);
+
+  // add rows of changes added to change table since last update
+  void update();
+
+  int numRows() const;
+
+  int numChanges() const { return int(rows_.size()); }
+
+  // first row and number of rows of change
+  int changeRow    (int i) const { return rows_[size_t(i)]; }
+  int changeNumRows(int i) const {
+    return std::max(changes_->len(CSIDE_TYPE_LEFT, i), changes_->len(CSIDE_TYPE_RIGHT, i));
+  }
+
+  // row of line (0-based)
+  int lineRow(CSideType side, int line) const;
+
+  // line and change of row
+  Row rowLine(CSideType side, int row) const;
+
+  // index of last change starting at or before row (-1 if none)
+  int rowChange(int row) const;
+
+ private:
+  using Ints = std::vector<int>;
+
+  int numLines(CSideType side) const {
+    return (side == CSIDE_TYPE_LEFT ? lnumLines_ : rnumLines_);
+  }
+
+  // index of last change starting at or before line (-1 if none)
+  int lineChange(CSideType side, int line) const;
+
+ private:
+  const CDiffChanges *changes_   { nullptr };
+  int                 lnumLines_ { 0 };
+  int                 rnumLines_ { 0 };
+  Ints                rows_; // first row of each change
+};
+
+#endif
@@ -0,0 +1,287 @@
+#include <CDiffSimd.h>
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CDIFF_SIMD_X86 1
+#endif
+
+namespace {
+
+using Byte = unsigned char;
+
+using Func     = size_t   (*)(const Byte *a, const Byte *b, size_t n);
+using MaskFunc = uint64_t (*)(const Byte *p, Byte c);
+using HighFunc = uint64_t (*)(const Byte *p);
+
+struct Impl {
+  Func        prefix;
+  Func        suffix;
+  MaskFunc    mask;
+  HighFunc    high;
+  const char *name;
+};
+
+//---
+
+size_t prefixScalar(const Byte *a, const Byte *b, size_t n) {
+  size_t i = 0;
+
+  for ( ; i + 8 <= n; i += 8) {
+    uint64_t wa, wb;
+
+    memcpy(&wa, a + i, 8);
+    memcpy(&wb, b + i, 8);
+
+    if (wa != wb)
+      break;
+  }
+
+  while (i < n && a[i] == b[i])
+    ++i;
+
+  return i;
+}
+
+size_t suffixScalar(const Byte *a, const Byte *b, size_t n) {
+  size_t i = 0;
+
+  for ( ; i + 8 <= n; i += 8) {
+    uint64_t wa, wb;
+
+    memcpy(&wa, a + n - i - 8, 8);
+    memcpy(&wb, b + n - i - 8, 8);
+
+    if (wa != wb)
+      break;
+  }
+
+  while (i < n && a[n - i - 1] == b[n - i - 1])
+    ++i;
+
+  return i;
+}
+
+uint64_t maskScalar(const Byte *p, size_t n, Byte c) {
+  uint64_t mask = 0;
+
+  for (size_t i = 0; i < n; ++i)
+    if (p[i] == c)
+      mask |= uint64_t(1) << i;
+
+  return mask;
+}
+
+uint64_t maskScalar64(const Byte *p, Byte c) {
+  return maskScalar(p, 64, c);
+}
+
+uint64_t highScalar(const Byte *p, size_t n) {
+  uint64_t mask = 0;
+
+  for (size_t i = 0; i < n; ++i)
+    if (p[i] >= 0x80)
+      mask |= uint64_t(1) << i;
+
+  return mask;
+}
+
+uint64_t highScalar64(const Byte *p) {
+  // most blocks are pure ascii
+  uint64_t w[8];
+
+  memcpy(w, p, 64);
+
+  if (! ((w[0] | w[1] | w[2] | w[3] | w[4] | w[5] | w[6] | w[7]) & 0x8080808080808080ULL))
+    return 0;
+
+  return highScalar(p, 64);
+}
+
+#ifdef CDIFF_SIMD_X86
+#ifdef __SSE2__
+size_t prefixSSE2(const Byte *a, const Byte *b, size_t n) {
+  size_t i = 0;
+
+  for ( ; i + 16 <= n; i += 16) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+
+    unsigned neq = ~unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb))) & 0xffff;
+
+    if (neq)
+      return i + unsigned(__builtin_ctz(neq));
+  }
+
+  return i + prefixScalar(a + i, b + i, n - i);
+}
+
+size_t suffixSSE2(const Byte *a, const Byte *b, size_t n) {
+  size_t i = 0;
+
+  for ( ; i + 16 <= n; i += 16) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + n - i - 16));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + n - i - 16));
+
+    unsigned neq = ~unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb))) & 0xffff;
+
+    if (neq)
+      return i + unsigned(__builtin_clz(neq)) - 16;
+  }
+
+  return i + suffixScalar(a, b, n - i);
+}
+
+uint64_t maskSSE2(const Byte *p, Byte c) {
+  __m128i vc = _mm_set1_epi8(char(c));
+
+  uint64_t mask = 0;
+
+  for (int i = 0; i < 4; ++i) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16*i));
+
+    mask |= uint64_t(unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(v, vc)))) << (16*i);
+  }
+
+  return mask;
+}
+
+uint64_t highSSE2(const Byte *p) {
+  uint64_t mask = 0;
+
+  // movemask takes the high bit of each byte
+  for (int i = 0; i < 4; ++i) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16*i));
+
+    mask |= uint64_t(unsigned(_mm_movemask_epi8(v))) << (16*i);
+  }
+
+  return mask;
+}
+#endif
+
+__attribute__((target("avx2")))
+size_t prefixAVX2(const Byte *a, const Byte *b, size_t n) {
+  size_t i = 0;
+
+  for ( ; i + 32 <= n; i += 32) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+
+    unsigned neq = ~unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)));
+
+    if (neq)
+      return i + unsigned(__builtin_ctz(neq));
+  }
+
+  return i + prefixScalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+size_t suffixAVX2(const Byte *a, const Byte *b, size_t n) {
+  size_t i = 0;
+
+  for ( ; i + 32 <= n; i += 32) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + n - i - 32));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + n - i - 32));
+
+    unsigned neq = ~unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)));
+
+    if (neq)
+      return i + unsigned(__builtin_clz(neq));
+  }
+
+  return i + suffixScalar(a, b, n - i);
+}
+
+__attribute__((target("avx2")))
+uint64_t maskAVX2(const Byte *p, Byte c) {
+  __m256i vc = _mm256_set1_epi8(char(c));
+
+  __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p     ));
+  __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 32));
+
+  uint64_t m1 = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, vc)));
+  uint64_t m2 = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v2, vc)));
+
+  return m1 | (m2 << 32);
+}
+
+__attribute__((target("avx2")))
+uint64_t highAVX2(const Byte *p) {
+  __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p     ));
+  __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 32));
+
+  uint64_t m1 = unsigned(_mm256_movemask_epi8(v1));
+  uint64_t m2 = unsigned(_mm256_movemask_epi8(v2));
+
+  return m1 | (m2 << 32);
+}
+#endif
+
+Impl selectImpl() {
+#ifdef CDIFF_SIMD_X86
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2"))
+    return Impl{ prefixAVX2, suffixAVX2, maskAVX2, highAVX2, "avx2" };
+
+#ifdef __SSE2__
+  return Impl{ prefixSSE2, suffixSSE2, maskSSE2, highSSE2, "sse2" };
+#endif
+#endif
+
+  return Impl{ prefixScalar, suffixScalar, maskScalar64, highScalar64, "scalar" };
+}
+
+const Impl &impl() {
+  static Impl impl = selectImpl();
+
+  return impl;
+}
+
+}
+
+//------
+
+namespace CDiffSimd {
+
+size_t
+commonPrefix(const void *a, const void *b, size_t n)
+{
+  return impl().prefix(static_cast<const Byte *>(a), static_cast<const Byte *>(b), n);
+}
+
+size_t
+commonSuffix(const void *a, const void *b, size_t n)
+{
+  return impl().suffix(static_cast<const Byte *>(a), static_cast<const Byte *>(b), n);
+}
+
+uint64_t
+byteMask(const void *p, size_t n, unsigned char c)
+{
+  if (n >= 64)
+    return impl().mask(static_cast<const Byte *>(p), c);
+
+  return maskScalar(static_cast<const Byte *>(p), n, c);
+}
+
+uint64_t
+highMask(const void *p, size_t n)
+{
+  if (n >= 64)
+    return impl().high(static_cast<const Byte *>(p));
+
+  return highScalar(static_cast<const Byte *>(p), n);
+}
+
+const char *
+implName()
+{
+  return impl().name;
+}
+
+}
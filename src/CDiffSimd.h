@@ -0,0 +1,27 @@
+#ifndef CDiffSimd_H
+#define CDiffSimd_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Vectorized byte compares and searches (AVX2 or SSE2 picked at runtime, scalar fallback)
+namespace CDiffSimd {
+
+// number of equal leading bytes of a and b (n bytes max)
+size_t commonPrefix(const void *a, const void *b, size_t n);
+
+// number of equal trailing bytes of a and b (both n bytes long)
+size_t commonSuffix(const void *a, const void *b, size_t n);
+
+// bit mask of bytes equal to c in first min(n, 64) bytes of p (bit i set for p[i])
+uint64_t byteMask(const void *p, size_t n, unsigned char c);
+
+// bit mask of non ascii bytes (>= 0x80) in first min(n, 64) bytes of p
+uint64_t highMask(const void *p, size_t n);
+
+// name of selected implementation
+const char *implName();
+
+}
+
+#endif
@@ -0,0 +1,163 @@
+#include <CDiffThreadPool.h>
+
+#include <algorithm>
+
+CDiffThreadPool::
+CDiffThreadPool(int numThreads) :
+ numThreads_(std::max(numThreads, 1))
+{
+}
+
+CDiffThreadPool::
+~CDiffThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    stop_ = true;
+  }
+
+  startCond_.notify_all();
+
+  for (auto &thread : threads_)
+    thread.join();
+}
+
+int
+CDiffThreadPool::
+defaultNumThreads()
+{
+  return std::max(int(std::thread::hardware_concurrency()), 1);
+}
+
+void
+CDiffThreadPool::
+run(Tasks &tasks)
+{
+  int nt = std::min(numThreads_, int(tasks.size()));
+
+  if (nt <= 1) {
+    for (auto &task : tasks)
+      task();
+
+    return;
+  }
+
+  if (threads_.empty())
+    startThreads();
+
+  for (size_t i = 0; i < tasks.size(); ++i)
+    queues_[i % size_t(nt)]->tasks.push_back(std::move(tasks[i]));
+
+  tasks.clear();
+
+  // no tasks are added once running so a thread is done when all queues are empty
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    ++batch_;
+
+    numBusy_ = int(threads_.size());
+  }
+
+  startCond_.notify_all();
+
+  workerLoop(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  doneCond_.wait(lock, [&]() { return numBusy_ == 0; });
+}
+
+void
+CDiffThreadPool::
+startThreads()
+{
+  for (int i = 0; i < numThreads_; ++i)
+    queues_.push_back(QueueP(new Queue));
+
+  for (int i = 1; i < numThreads_; ++i)
+    threads_.emplace_back(&CDiffThreadPool::threadLoop, this, i);
+}
+
+// wait for each batch and work on it until all queues are empty
+void
+CDiffThreadPool::
+threadLoop(int i)
+{
+  uint batch = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      startCond_.wait(lock, [&]() { return stop_ || batch_ != batch; });
+
+      if (stop_)
+        return;
+
+      batch = batch_;
+    }
+
+    workerLoop(i);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      if (--numBusy_ == 0)
+        doneCond_.notify_one();
+    }
+  }
+}
+
+void
+CDiffThreadPool::
+workerLoop(int i)
+{
+  Task task;
+
+  while (popTask(i, task)) {
+    task();
+
+    task = Task();
+  }
+}
+
+bool
+CDiffThreadPool::
+popTask(int i, Task &task)
+{
+  // own queue (oldest first)
+  {
+    auto &queue = *queues_[size_t(i)];
+
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (! queue.tasks.empty()) {
+      task = std::move(queue.tasks.front());
+
+      queue.tasks.pop_front();
+
+      return true;
+    }
+  }
+
+  // steal oldest task from other queues
+  int nq = int(queues_.size());
+
+  for (int j = 1; j < nq; ++j) {
+    auto &queue = *queues_[size_t((i + j) % nq)];
+
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (! queue.tasks.empty()) {
+      task = std::move(queue.tasks.front());
+
+      queue.tasks.pop_front();
+
+      return true;
+    }
+  }
+
+  return false;
+}
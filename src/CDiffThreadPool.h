@@ -0,0 +1,66 @@
+#ifndef CDiffThreadPool_H
+#define CDiffThreadPool_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work stealing pool for a batch of independent tasks. Tasks are dealt round robin to
+// per thread queues, each thread pops from the front of its own queue (so tasks start
+// roughly in order, which ordered delivery of results relies on) and steals from the
+// front of the other queues when its own queue is empty. Threads are started by the
+// first run which needs them and wait for the next batch in later runs, so a long
+// lived pool can be used for frequent small batches (e.g. drawing).
+class CDiffThreadPool {
+ public:
+  using Task  = std::function<void()>;
+  using Tasks = std::vector<Task>;
+
+ public:
+  CDiffThreadPool(int numThreads);
+ ~CDiffThreadPool();
+
+  int numThreads() const { return numThreads_; }
+
+  // run all tasks to completion (calling thread is one of the workers, only one run
+  // at a time)
+  void run(Tasks &tasks);
+
+  static int defaultNumThreads();
+
+ private:
+  struct Queue {
+    std::mutex       mutex;
+    std::deque<Task> tasks;
+  };
+
+  using QueueP = std::unique_ptr<Queue>;
+  using Queues = std::vector<QueueP>;
+
+  using Threads = std::vector<std::thread>;
+
+  void startThreads();
+
+  void threadLoop(int i);
+
+  bool popTask(int i, Task &task);
+
+  void workerLoop(int i);
+
+ private:
+  int                     numThreads_ { 1 };
+  Queues                  queues_;         // per thread queues
+  Threads                 threads_;        // threads 1 to numThreads - 1
+  std::mutex              mutex_;
+  std::condition_variable startCond_;
+  std::condition_variable doneCond_;
+  uint                    batch_      { 0 }; // number of batches run (locked by mutex)
+  int                     numBusy_    { 0 }; // threads running batch (locked by mutex)
+  bool                    stop_       { false };
+};
+
+#endif
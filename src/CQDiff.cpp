@@ -1,8 +1,7 @@
 #include <CQDiff.h>
 #include <CQToolBar.h>
 #include <CQMenu.h>
-#include <CFile.h>
-#include <CCommand.h>
+#include <CDiffThreadPool.h>
 #include <CStrUtil.h>
 #include <CStrParse.h>
 
@@ -10,10 +9,27 @@
 #include <QGridLayout>
 #include <QScrollBar>
 #include <QLabel>
+#include <QLineEdit>
+#include <QInputDialog>
+#include <QMessageBox>
+#include <QSettings>
+#include <QListView>
 #include <QStatusBar>
 #include <QPainter>
-
+#include <QFontInfo>
+#include <QResizeEvent>
+#include <QTimer>
+#include <QFileSystemWatcher>
+#include <QFileInfo>
+#include <QProcess>
+
+#include <algorithm>
 #include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 #include <svg/first_diff_svg.h>
 #include <svg/last_diff_svg.h>
@@ -21,18 +37,132 @@
 #include <svg/prev_diff_svg.h>
 #include <svg/reload_svg.h>
 
+// Background load/diff request. Runs on a worker thread and is handed back to the
+// gui thread when done, where it is applied only if it is still the latest request.
+// Hunks are queued as they are found and applied by the gui thread while running.
+struct CQDiff::DiffJob {
+  enum class Stage {
+    LOAD,
+    DIFF
+  };
+
+  uint                   generation       { 0 };
+  bool                   reload           { false };
+  std::string            lfileName;
+  std::string            rfileName;
+  LinesP                 lines;
+  CDiffEngine::Algorithm algorithm        { CDiffEngine::Algorithm::MYERS };
+  uint                   ignoreFlags      { CDiffEngine::IGNORE_NONE };
+  MaskP                  mask;            // copy of rules when job started
+  bool                   externalDiff     { false };
+  int                    linearSpaceLines { 0 };
+  bool                   detectMoves      { true };
+  bool                   incremental      { false }; // only diff changed lines
+  bool                   movesOnly        { false }; // only find moves of changes
+  LinesP                 prevLines;       // lines of previous result (incremental)
+  CDiffChanges           prevChanges;     // changes of previous result (incremental)
+  CDiffChanges::Region   region;          // previous changes re-diffed (incremental)
+  int                    numRegionChanges { 0 }; // changes found in region (incremental)
+  std::mutex             mutex;
+  CDiffEngine::Hunks     hunks;           // found but not yet applied (locked by mutex)
+  CDiffChanges           changes;         // all found hunks (worker thread)
+  CDiffMoves             moves;           // moved blocks of changes (worker thread)
+  bool                   started          { false }; // result applied (gui thread)
+  bool                   cancelled        { false };
+  std::atomic<bool>      cancel           { false };
+  std::atomic<Stage>     stage            { Stage::LOAD };
+  std::atomic<int>       progress         { 0 };
+  std::string            errorMsg;        // why load failed (worker thread)
+  std::atomic<bool>      finished         { false }; // thread can be joined
+};
+
+// Inline diff worker thread. Requests are queued by the gui thread and diffed in
+// order, requests of an older generation (inline diffs cleared) are abandoned
+// between line pairs.
+struct CQDiff::InlineWorker {
+  // line pairs of change
+  struct Task {
+    int change { 0 };
+    int lfirst { 0 };
+    int rfirst { 0 };
+    int npairs { 0 };
+  };
+
+  using Tasks = std::vector<Task>;
+
+  struct Request {
+    LinesP            lines;
+    CDiffInline::Mode mode       { CDiffInline::Mode::WORD };
+    uint              generation { 0 };
+    Tasks             tasks;
+  };
+
+  std::mutex              mutex;
+  std::condition_variable cond;
+  std::deque<Request>     requests;        // locked by mutex
+  std::atomic<bool>       stop       { false };
+  std::atomic<uint>       generation { 0 }; // current inline generation
+  std::thread             thread;
+};
+
+//------
+
 CQDiff::
 CQDiff() :
  CQMainWindow("CQDiff")
 {
   setObjectName("diff");
 
+  lines_ = std::make_shared<CDiffLines>();
+  mask_  = std::make_shared<CDiffMask>();
+
+  // threads are kept between paints
+  renderPool_ = std::make_unique<CDiffThreadPool>(CDiffThreadPool::defaultNumThreads());
+
+  progressTimer_ = new QTimer(this);
+
+  progressTimer_->setInterval(100);
+
+  connect(progressTimer_, SIGNAL(timeout()), this, SLOT(progressSlot()));
+
+  // reload after burst of file modifications has finished
+  reloadTimer_ = new QTimer(this);
+
+  reloadTimer_->setSingleShot(true);
+  reloadTimer_->setInterval(reloadDelay());
+
+  connect(reloadTimer_, SIGNAL(timeout()), this, SLOT(reloadSlot()));
+
+  watcher_ = new QFileSystemWatcher(this);
+
+  connect(watcher_, SIGNAL(fileChanged(const QString &)),
+          this, SLOT(fileChangedSlot(const QString &)));
+
   connect(this, SIGNAL(changeNumChanged()), this, SLOT(scrollToChange()));
 }
 
 CQDiff::
 ~CQDiff()
 {
+  // running jobs finish early and their results are dropped (queued results of
+  // deleted window are discarded)
+  for (auto &jobThread : jobThreads_)
+    jobThread.job->cancel = true;
+
+  for (auto &jobThread : jobThreads_)
+    jobThread.thread.join();
+
+  if (inlineWorker_) {
+    {
+      std::lock_guard<std::mutex> lock(inlineWorker_->mutex);
+
+      inlineWorker_->stop = true;
+    }
+
+    inlineWorker_->cond.notify_one();
+
+    inlineWorker_->thread.join();
+  }
 }
 
 void
@@ -42,10 +172,9 @@ setFiles(const std::string &src, const std::string &dst)
   addSrc(src);
   addDst(dst);
 
-  exec();
+  watchFiles();
 
-  ledit_->update();
-  redit_->update();
+  startJob(/*reload*/true);
 }
 
 void
@@ -66,318 +195,1622 @@ addDst(const std::string &dst)
   redit_->setFileName(dst.c_str());
 }
 
+// diff currently loaded lines
 void
 CQDiff::
 exec()
 {
-  ledit_->reset();
-  redit_->reset();
+  startJob(/*reload*/false);
+}
+
+void
+CQDiff::
+startJob(bool reload, bool incremental, bool movesOnly)
+{
+  // stop any running job (its result is dropped as the generation no longer matches)
+  if (job_) {
+    // still need to load files if running job's lines haven't been used yet
+    if (job_->reload && ! job_->started)
+      reload = true;
 
-  changeNum_ = 0;
+    job_->cancel = true;
+  }
 
-  //---
+  DiffJobP job = std::make_shared<DiffJob>();
+
+  job->generation       = ++generation_;
+  job->reload           = reload;
+  job->lfileName        = ledit_->getFileName().toStdString();
+  job->rfileName        = redit_->getFileName().toStdString();
+  job->lines            = (reload ? std::make_shared<CDiffLines>() : lines_);
+  job->algorithm        = algorithm();
+  job->ignoreFlags      = ignoreFlags();
+  job->mask             = mask_;
+  job->externalDiff     = isExternalDiff();
+  job->linearSpaceLines = linearSpaceLines();
+  job->detectMoves      = isDetectMoves();
+  job->incremental      = incremental;
+  job->movesOnly        = movesOnly;
+  job->stage            = (reload ? DiffJob::Stage::LOAD : DiffJob::Stage::DIFF);
+
+  if (reload) {
+    job->lines->setNumThreads(CDiffThreadPool::defaultNumThreads());
+
+    // files may be rewritten in place while the result (and drawing) uses their lines
+    // so they are read into memory (a mapped file truncated on disk faults with SIGBUS)
+    job->lines->setCopyFiles(true);
+  }
 
-  // run diff command
-  std::vector<std::string> args;
+  if (incremental) {
+    job->prevLines   = lines_;
+    job->prevChanges = changes_;
+  }
 
-  if (isIgnoreWhiteSpace())
-    args.push_back("-bw");
+  // moves of current result (lines matched as when it was diffed)
+  if (movesOnly) {
+    job->ignoreFlags = resultState_.ignoreFlags;
+    job->mask        = resultState_.mask;
+    job->changes     = changes_;
+  }
 
-  args.push_back(ledit_->getFileName().toStdString());
-  args.push_back(redit_->getFileName().toStdString());
+  job_ = job;
 
-  CCommand cmd("diff", "diff", args);
+  joinJobThreads();
 
-  std::string result;
+  JobThread jobThread;
 
-  cmd.addStringDest(result);
+  jobThread.job    = job;
+  jobThread.thread = std::thread([this, job]() {
+    execJob(*job);
 
-  cmd.start();
+    QMetaObject::invokeMethod(this, [this, job]() { jobFinished(job); },
+                              Qt::QueuedConnection);
 
-  cmd.wait();
+    job->finished = true;
+  });
 
-  //---
+  jobThreads_.push_back(std::move(jobThread));
 
-  std::vector<std::string> lines;
+  cancelItem_->setEnabled(true);
 
-  CStrUtil::addLines(result, lines);
+  progressTimer_->start();
 
-  for (const auto &line : lines) {
-    auto len = line.size();
+  progressSlot();
+}
 
-    if (len == 0 || ! isdigit(line[0]))
-      continue;
+// join threads of finished (or cancelled) jobs
+void
+CQDiff::
+joinJobThreads()
+{
+  auto p = jobThreads_.begin();
 
-    parseChange(line);
+  while (p != jobThreads_.end()) {
+    if ((*p).job->finished) {
+      (*p).thread.join();
+
+      p = jobThreads_.erase(p);
+    }
+    else
+      ++p;
   }
+}
 
-  diffCombo_->load();
+// run on worker thread
+void
+CQDiff::
+execJob(DiffJob &job)
+{
+  if (job.reload) {
+    if (! job.lines->load(job.lfileName, job.rfileName, &job.cancel)) {
+      job.errorMsg  = job.lines->errorMsg();
+      job.cancelled = true;
+      return;
+    }
+  }
+
+  job.stage = DiffJob::Stage::DIFF;
+
+  bool rc;
+
+  if      (job.movesOnly) {
+    rc = execMoves(job);
+
+    if (! rc || job.cancel)
+      job.cancelled = true;
+
+    return;
+  }
+  else if (job.incremental)
+    rc = execIncremental(job);
+  else if (job.externalDiff)
+    rc = execExternal(job);
+  else
+    rc = execInternal(job);
+
+  if (rc && ! job.cancel && job.detectMoves)
+    rc = execMoves(job);
+
+  if (! rc || job.cancel)
+    job.cancelled = true;
 }
 
 bool
 CQDiff::
-parseChange(const std::string &line)
+execInternal(DiffJob &job)
 {
-  CStrParse parse(line);
+  // diff lines already loaded
+  CDiffEngine engine;
 
-  int lstart = 0;
+  if (! initEngine(job, engine))
+    return false;
 
-  if (! parse.readInteger(&lstart))
+  engine.setHunkProc([&job](const CDiffEngine::Hunks &hunks) { addJobHunks(job, hunks); });
+
+  CDiffEngine::Hunks hunks;
+
+  return engine.exec(job.lines->ids(CSIDE_TYPE_LEFT), job.lines->ids(CSIDE_TYPE_RIGHT),
+                     hunks);
+}
+
+// diff lines of reloaded files between lines unchanged since previous result and keep
+// previous changes outside them (worker thread)
+bool
+CQDiff::
+execIncremental(DiffJob &job)
+{
+  const auto &prevLines = *job.prevLines;
+  const auto &lines     = *job.lines;
+
+  int lpre, lsuf, rpre, rsuf;
+
+  CDiffFile::commonLines(prevLines.file(CSIDE_TYPE_LEFT ), lines.file(CSIDE_TYPE_LEFT ),
+                         lpre, lsuf);
+  CDiffFile::commonLines(prevLines.file(CSIDE_TYPE_RIGHT), lines.file(CSIDE_TYPE_RIGHT),
+                         rpre, rsuf);
+
+  int lnum = prevLines.numLines(CSIDE_TYPE_LEFT );
+  int rnum = prevLines.numLines(CSIDE_TYPE_RIGHT);
+
+  const auto &prev = job.prevChanges;
+
+  job.region = prev.changedRegion(lnum, rnum, lpre, lsuf, rpre, rsuf);
+
+  const auto &region = job.region;
+
+  // lines after region are moved by change in line count
+  int ldelta = lines.numLines(CSIDE_TYPE_LEFT ) - lnum;
+  int rdelta = lines.numLines(CSIDE_TYPE_RIGHT) - rnum;
+
+  //---
+
+  // diff region
+  const auto &lids = lines.ids(CSIDE_TYPE_LEFT );
+  const auto &rids = lines.ids(CSIDE_TYPE_RIGHT);
+
+  CDiffLines::Ids lids1(lids.begin() + region.lstart, lids.begin() + region.lend + ldelta);
+  CDiffLines::Ids rids1(rids.begin() + region.rstart, rids.begin() + region.rend + rdelta);
+
+  CDiffEngine engine;
+
+  if (! initEngine(job, engine))
     return false;
 
-  int lend = lstart;
+  CDiffEngine::Hunks regionHunks;
 
-  if (parse.isChar(',')) {
-    parse.skipChar();
+  if (! engine.exec(lids1, rids1, regionHunks))
+    return false;
 
-    if (! parse.readInteger(&lend))
+  job.numRegionChanges = int(regionHunks.size());
+
+  //---
+
+  // previous changes before region, region changes and moved previous changes after region
+  CDiffEngine::Hunks hunks;
+
+  hunks.reserve(size_t(prev.size() - (region.change2 - region.change1)) + regionHunks.size());
+
+  auto addPrev = [&](int i, int ldelta, int rdelta) {
+    hunks.emplace_back(prev.type(i),
+      prev.start(CSIDE_TYPE_LEFT , i) + ldelta, prev.end(CSIDE_TYPE_LEFT , i) + ldelta,
+      prev.start(CSIDE_TYPE_RIGHT, i) + rdelta, prev.end(CSIDE_TYPE_RIGHT, i) + rdelta);
+  };
+
+  for (int i = 0; i < region.change1; ++i)
+    addPrev(i, 0, 0);
+
+  for (auto hunk : regionHunks) {
+    hunk.lstart += region.lstart; hunk.lend += region.lstart;
+    hunk.rstart += region.rstart; hunk.rend += region.rstart;
+
+    hunks.push_back(hunk);
+  }
+
+  for (int i = region.change2; i < prev.size(); ++i)
+    addPrev(i, ldelta, rdelta);
+
+  addJobHunks(job, hunks);
+
+  return true;
+}
+
+// set diff engine options of job (returns false if cancelled)
+bool
+CQDiff::
+initEngine(DiffJob &job, CDiffEngine &engine)
+{
+  engine.setAlgorithm       (job.algorithm);
+  engine.setIgnoreFlags     (job.ignoreFlags);
+  engine.setMask            (job.mask.get());
+  engine.setLineTable       (&job.lines->lineTable());
+  engine.setNumThreads      (CDiffThreadPool::defaultNumThreads());
+  engine.setLinearSpaceLines(uint(job.linearSpaceLines));
+  engine.setCancel          (&job.cancel);
+  engine.setProgress        (&job.progress);
+
+  // normalized lines are cached so changing ignore flags or mask doesn't redo them
+  if (CDiffEngine::isNormalized(job.ignoreFlags, job.mask.get())) {
+    auto *normIds = job.lines->normIds(job.ignoreFlags, job.mask.get(), &job.cancel);
+
+    if (! normIds)
       return false;
+
+    engine.setNormIds(&normIds->ids, normIds->numIds);
   }
 
-  char c;
+  return true;
+}
 
-  if (! parse.readChar(&c))
-    return false;
+// run diff command, hunks are queued as the output is read
+bool
+CQDiff::
+execExternal(DiffJob &job)
+{
+  QStringList args;
 
-  int rstart = 0;
+  if (job.ignoreFlags & CDiffEngine::IGNORE_ALL_SPACE     ) args << "-w";
+  if (job.ignoreFlags & CDiffEngine::IGNORE_SPACE_CHANGE  ) args << "-b";
+  if (job.ignoreFlags & CDiffEngine::IGNORE_TRAILING_SPACE) args << "-Z";
+  if (job.ignoreFlags & CDiffEngine::IGNORE_CASE          ) args << "-i";
+  if (job.ignoreFlags & CDiffEngine::IGNORE_CR            ) args << "--strip-trailing-cr";
 
-  if (! parse.readInteger(&rstart))
+  args << QString::fromStdString(job.lfileName);
+  args << QString::fromStdString(job.rfileName);
+
+  QProcess proc;
+
+  proc.start("diff", args);
+
+  if (! proc.waitForStarted())
     return false;
 
-  int rend = rstart;
+  CDiffEngine::Hunks hunks;
 
-  if (parse.isChar(',')) {
-    parse.skipChar();
+  auto addLine = [&](const QByteArray &bytes) {
+    std::string line = bytes.trimmed().toStdString();
+
+    if (line.empty() || ! isdigit(line[0]))
+      return;
+
+    CDiffEngine::Hunk hunk;
+
+    if (parseHunk(line, hunk))
+      hunks.push_back(hunk);
+  };
+
+  for (;;) {
+    bool running = (proc.state() != QProcess::NotRunning);
+
+    if (running && ! proc.canReadLine())
+      proc.waitForReadyRead(100);
+
+    while (proc.canReadLine())
+      addLine(proc.readLine());
+
+    if (! hunks.empty()) {
+      addJobHunks(job, hunks);
+
+      hunks.clear();
+    }
+
+    if (job.cancel) {
+      proc.kill();
+
+      proc.waitForFinished();
 
-    if (! parse.readInteger(&rend))
       return false;
+    }
+
+    if (! running)
+      break;
   }
 
-  auto num = changes_.size() + 1;
+  // last line without newline
+  addLine(proc.readAllStandardOutput());
 
-  CQDiffChange change(uint(num), char(c), lstart, lend, rstart, rend);
+  addJobHunks(job, hunks);
 
-  change.setString(line);
+  return true;
+}
 
-  changes_.push_back(change);
+// find moved blocks of all found hunks (worker thread)
+bool
+CQDiff::
+execMoves(DiffJob &job)
+{
+  // match lines with ignored differences (ids are cached by diff)
+  const CDiffLines::Ids *normIds = nullptr;
 
-  ledit_->addChange(uint(num), char(c)         , lstart, lend);
-  redit_->addChange(uint(num), char(toupper(c)), rstart, rend);
+  if (CDiffEngine::isNormalized(job.ignoreFlags, job.mask.get())) {
+    auto *normIds1 = job.lines->normIds(job.ignoreFlags, job.mask.get(), &job.cancel);
 
-  return true;
+    if (! normIds1)
+      return false;
+
+    normIds = &normIds1->ids;
+  }
+
+  return job.moves.find(job.changes, job.lines->ids(CSIDE_TYPE_LEFT),
+                        job.lines->ids(CSIDE_TYPE_RIGHT), normIds, &job.cancel);
 }
 
-QWidget *
+// queue found hunks for gui thread (worker thread)
+void
 CQDiff::
-createCentralWidget()
+addJobHunks(DiffJob &job, const CDiffEngine::Hunks &hunks)
 {
-  frame_ = new QWidget(this);
+  if (job.detectMoves) {
+    for (const auto &hunk : hunks)
+      job.changes.add(hunk.c, hunk.lstart, hunk.lend, hunk.rstart, hunk.rend);
+  }
 
-  frame_->setObjectName("frame");
+  std::lock_guard<std::mutex> lock(job.mutex);
 
-  QGridLayout *layout = new QGridLayout(frame_);
+  job.hunks.insert(job.hunks.end(), hunks.begin(), hunks.end());
+}
 
-  llabel_ = new QLabel;
-  rlabel_ = new QLabel;
+// apply job result (gui thread)
+void
+CQDiff::
+jobFinished(const DiffJobP &job)
+{
+  joinJobThreads();
 
-  llabel_->setAlignment(Qt::AlignHCenter);
-  rlabel_->setAlignment(Qt::AlignHCenter);
+  // drop result of superseded or cancelled job
+  if (job->generation != generation_)
+    return;
 
-  llabel_->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
-  rlabel_->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+  job_.reset();
 
-  layout->addWidget(llabel_, 0, 0);
-  layout->addWidget(rlabel_, 0, 2);
+  progressTimer_->stop();
 
-  ledit_ = new CQFileEdit(this, CSIDE_TYPE_LEFT);
-  vbar_  = new CQDiffBar (this);
-  redit_ = new CQFileEdit(this, CSIDE_TYPE_RIGHT);
+  cancelItem_->setEnabled(false);
 
-  layout->addWidget(ledit_, 1, 0);
-  layout->addWidget(vbar_ , 1, 1);
-  layout->addWidget(redit_, 1, 2);
+  if (job->cancelled) {
+    if (! job->errorMsg.empty()) {
+      lslabel_->setText(QString::fromStdString(job->errorMsg));
+      rslabel_->setText("");
 
-  connect(vbar_, SIGNAL(valueChanged(int)), this, SLOT(scrollSlot(int)));
+      // auto reload retries when the file is replaced so only show status
+      if (! isAutoReload())
+        QMessageBox::warning(this, "Load Failed", QString::fromStdString(job->errorMsg));
+    }
+    else {
+      lslabel_->setText("Cancelled");
+      rslabel_->setText("");
+    }
 
-  return frame_;
+    return;
+  }
+
+  //---
+
+  if (job->movesOnly) {
+    resultState_.detectMoves = true;
+
+    moves_ = std::move(job->moves);
+
+    updateMoves();
+  }
+  else {
+    // incremental result keeps scroll position
+    int scrollPos = vbar_->value();
+
+    if (! job->started)
+      beginJobResult(*job);
+
+    applyJobHunks(*job);
+
+    if (job->incremental) {
+      changeNum_ = std::max(std::min(changeNum_, getNumChanges() - 1), 0);
+
+      vbar_->setValue(scrollPos);
+
+      updateDiffItems();
+    }
+
+    if (! job->externalDiff) {
+      resultState_.complete    = true;
+      resultState_.algorithm   = job->algorithm;
+      resultState_.ignoreFlags = job->ignoreFlags;
+      resultState_.mask        = job->mask;
+      resultState_.detectMoves = job->detectMoves;
+    }
+
+    // moves are found after all hunks
+    if (! job->moves.empty()) {
+      moves_ = std::move(job->moves);
+
+      updateMoves();
+    }
+  }
+
+  lslabel_->setText("");
+
+  QString text;
+
+  if (! moves_.empty())
+    text = QString("%1 differences, %2 moved blocks").arg(getNumChanges()).arg(moves_.size());
+  else
+    text = QString("%1 differences").arg(getNumChanges());
+
+  // external diff only supports the ignore flags
+  if (job->externalDiff && job->mask && ! job->mask->empty())
+    text += " (mask rules not applied by external diff)";
+
+  rslabel_->setText(text);
 }
 
+// redraw after moves of result changed (gui thread)
 void
 CQDiff::
-createMenus()
+updateMoves()
 {
-  fileMenu_ = new CQMenu(this, "File");
+  diffCombo_->load();
 
-  CQMenuItem *quitItem = new CQMenuItem(fileMenu_, "Quit");
+  ++resultId_;
 
-  quitItem->setShortcut("Ctrl+Q");
-  quitItem->setStatusTip("Quit the application");
+  vbar_->update();
 
-  connect(quitItem->getAction(), SIGNAL(triggered()), this, SLOT(close()));
+  ledit_->update();
+  redit_->update();
+}
 
-  //--------
+// replace current result with (empty) job result (gui thread)
+void
+CQDiff::
+beginJobResult(DiffJob &job)
+{
+  if (job.reload)
+    lines_ = job.lines;
 
-  diffMenu_ = new CQMenu(this, "Diff");
+  changes_.clear();
 
-  firstDiffItem_ = new CQMenuItem(diffMenu_, "First Diff");
+  moves_.clear();
 
-  firstDiffItem_->setStatusTip("Move to first difference");
-  firstDiffItem_->setIcon(CQPixmapCacheInst->getIcon("FIRST_DIFF"));
+  rows_.reset(&changes_, lines_->numLines(CSIDE_TYPE_LEFT),
+              lines_->numLines(CSIDE_TYPE_RIGHT));
 
-  firstDiffItem_->connect(this, SLOT(firstDiffSlot()));
+  // keep selected change of incremental result (moved by change count of region)
+  if (job.incremental) {
+    const auto &region = job.region;
 
-  lastDiffItem_ = new CQMenuItem(diffMenu_, "Last Diff");
+    if      (changeNum_ >= region.change2)
+      changeNum_ += job.numRegionChanges - (region.change2 - region.change1);
+    else if (changeNum_ >= region.change1)
+      changeNum_ = region.change1;
+  }
+  else
+    changeNum_ = 0;
 
-  lastDiffItem_->setStatusTip("Move to last difference");
-  lastDiffItem_->setIcon(CQPixmapCacheInst->getIcon("LAST_DIFF"));
+  resultState_.complete = false;
 
-  lastDiffItem_->connect(this, SLOT(lastDiffSlot()));
+  clearInlineDiffs();
 
-  nextDiffItem_ = new CQMenuItem(diffMenu_, "Next Diff");
+  diffCombo_->load();
 
-  nextDiffItem_->setStatusTip("Move to next difference");
-  nextDiffItem_->setIcon(CQPixmapCacheInst->getIcon("NEXT_DIFF"));
+  ++resultId_;
+  ++changesId_;
 
-  nextDiffItem_->connect(this, SLOT(nextDiffSlot()));
+  updateDataHeight();
 
-  prevDiffItem_ = new CQMenuItem(diffMenu_, "Prev Diff");
+  job.started = true;
 
-  prevDiffItem_->setStatusTip("Move to previous difference");
-  prevDiffItem_->setIcon(CQPixmapCacheInst->getIcon("PREV_DIFF"));
+  ledit_->update();
+  redit_->update();
+}
 
-  prevDiffItem_->connect(this, SLOT(prevDiffSlot()));
+// add hunks found since last call (gui thread)
+void
+CQDiff::
+applyJobHunks(DiffJob &job)
+{
+  CDiffEngine::Hunks hunks;
 
-  whiteSpaceItem_ = new CQMenuItem(diffMenu_, "Ignore White Space", CQMenuItem::CHECKABLE);
+  {
+    std::lock_guard<std::mutex> lock(job.mutex);
 
-  prevDiffItem_->setStatusTip("Ignore White Space");
+    hunks.swap(job.hunks);
+  }
 
-  whiteSpaceItem_->connect(this, SLOT(whiteSpaceSlot(bool)));
+  if (hunks.empty())
+    return;
 
-  recompItem_ = new CQMenuItem(diffMenu_, "Recompute Diff");
+  int numChanges = changes_.size();
+  int numRows    = rows_.numRows();
 
-  recompItem_->setStatusTip("Recompute differences");
-  recompItem_->setIcon(CQPixmapCacheInst->getIcon("RELOAD"));
+  changes_.reserve(size_t(numChanges) + hunks.size());
 
-  recompItem_->connect(this, SLOT(recomputeSlot()));
+  for (const auto &hunk : hunks)
+    addChange(hunk.c, hunk.lstart, hunk.lend, hunk.rstart, hunk.rend);
 
-  //--------
+  diffCombo_->append();
 
-  viewMenu_ = new CQMenu(this, "View");
+  // rows above first added change are unchanged
+  int row1 = rows_.changeRow(numChanges);
+  int row2 = std::max(numRows, rows_.numRows()) - 1;
+
+  ledit_->invalidateRows(row1, row2);
+  redit_->invalidateRows(row1, row2);
+
+  ++changesId_;
+
+  updateDataHeight();
+
+  vbar_->update();
+
+  ledit_->update();
+  redit_->update();
+}
+
+void
+CQDiff::
+progressSlot()
+{
+  if (! job_)
+    return;
+
+  // show lines and hunks found so far once loaded (incremental result replaces previous
+  // result when complete)
+  if (job_->stage == DiffJob::Stage::DIFF && ! job_->incremental && ! job_->movesOnly) {
+    if (! job_->started)
+      beginJobResult(*job_);
+
+    applyJobHunks(*job_);
+  }
+
+  if      (job_->stage == DiffJob::Stage::LOAD)
+    lslabel_->setText("Loading files ...");
+  else if (job_->movesOnly)
+    lslabel_->setText("Finding moved blocks ...");
+  else
+    lslabel_->setText("Computing differences ...");
+
+  if (job_->stage == DiffJob::Stage::DIFF && ! job_->externalDiff && ! job_->movesOnly)
+    rslabel_->setText(QString("%1%").arg(int(job_->progress)));
+  else
+    rslabel_->setText("");
+}
+
+void
+CQDiff::
+cancelSlot()
+{
+  if (! job_)
+    return;
+
+  job_->cancel = true;
+
+  // drop result now rather than waiting for the job to stop
+  ++generation_;
+
+  job_.reset();
+
+  progressTimer_->stop();
+
+  cancelItem_->setEnabled(false);
+
+  lslabel_->setText("Cancelled");
+  rslabel_->setText("");
+}
+
+bool
+CQDiff::
+parseChange(const std::string &line)
+{
+  CDiffEngine::Hunk hunk;
+
+  if (! parseHunk(line, hunk))
+    return false;
+
+  addChange(hunk.c, hunk.lstart, hunk.lend, hunk.rstart, hunk.rend);
+
+  return true;
+}
+
+// parse diff normal format change line "<l1>[,<l2>]<c><r1>[,<r2>]"
+bool
+CQDiff::
+parseHunk(const std::string &line, CDiffEngine::Hunk &hunk)
+{
+  CStrParse parse(line);
+
+  int lstart = 0;
+
+  if (! parse.readInteger(&lstart))
+    return false;
+
+  int lend = lstart;
+
+  if (parse.isChar(',')) {
+    parse.skipChar();
+
+    if (! parse.readInteger(&lend))
+      return false;
+  }
+
+  char c;
+
+  if (! parse.readChar(&c))
+    return false;
+
+  int rstart = 0;
+
+  if (! parse.readInteger(&rstart))
+    return false;
+
+  int rend = rstart;
+
+  if (parse.isChar(',')) {
+    parse.skipChar();
+
+    if (! parse.readInteger(&rend))
+      return false;
+  }
+
+  hunk = CDiffEngine::Hunk(c, lstart, lend, rstart, rend);
+
+  return true;
+}
+
+void
+CQDiff::
+addChange(char c, int lstart, int lend, int rstart, int rend)
+{
+  changes_.add(c, lstart, lend, rstart, rend);
+
+  rows_.update();
+}
+
+QWidget *
+CQDiff::
+createCentralWidget()
+{
+  frame_ = new QWidget(this);
+
+  frame_->setObjectName("frame");
+
+  QGridLayout *layout = new QGridLayout(frame_);
+
+  llabel_ = new QLabel;
+  rlabel_ = new QLabel;
+
+  llabel_->setAlignment(Qt::AlignHCenter);
+  rlabel_->setAlignment(Qt::AlignHCenter);
+
+  llabel_->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+  rlabel_->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+
+  layout->addWidget(llabel_, 0, 0);
+  layout->addWidget(rlabel_, 0, 2);
+
+  ledit_ = new CQFileEdit(this, CSIDE_TYPE_LEFT);
+  vbar_  = new CQDiffBar (this);
+  redit_ = new CQFileEdit(this, CSIDE_TYPE_RIGHT);
+
+  layout->addWidget(ledit_, 1, 0);
+  layout->addWidget(vbar_ , 1, 1);
+  layout->addWidget(redit_, 1, 2);
+
+  connect(vbar_, SIGNAL(valueChanged(int)), this, SLOT(scrollSlot(int)));
+
+  return frame_;
+}
+
+void
+CQDiff::
+createMenus()
+{
+  fileMenu_ = new CQMenu(this, "File");
+
+  autoReloadItem_ = new CQMenuItem(fileMenu_, "Auto Reload", CQMenuItem::CHECKABLE);
+
+  autoReloadItem_->setStatusTip("Reload and diff changed lines when files are modified");
+
+  autoReloadItem_->connect(this, SLOT(autoReloadSlot(bool)));
+
+  CQMenuItem *quitItem = new CQMenuItem(fileMenu_, "Quit");
+
+  quitItem->setShortcut("Ctrl+Q");
+  quitItem->setStatusTip("Quit the application");
+
+  connect(quitItem->getAction(), SIGNAL(triggered()), this, SLOT(close()));
+
+  //--------
+
+  diffMenu_ = new CQMenu(this, "Diff");
+
+  firstDiffItem_ = new CQMenuItem(diffMenu_, "First Diff");
+
+  firstDiffItem_->setStatusTip("Move to first difference");
+  firstDiffItem_->setIcon(CQPixmapCacheInst->getIcon("FIRST_DIFF"));
+
+  firstDiffItem_->connect(this, SLOT(firstDiffSlot()));
+
+  lastDiffItem_ = new CQMenuItem(diffMenu_, "Last Diff");
+
+  lastDiffItem_->setStatusTip("Move to last difference");
+  lastDiffItem_->setIcon(CQPixmapCacheInst->getIcon("LAST_DIFF"));
+
+  lastDiffItem_->connect(this, SLOT(lastDiffSlot()));
+
+  nextDiffItem_ = new CQMenuItem(diffMenu_, "Next Diff");
+
+  nextDiffItem_->setStatusTip("Move to next difference");
+  nextDiffItem_->setIcon(CQPixmapCacheInst->getIcon("NEXT_DIFF"));
+
+  nextDiffItem_->connect(this, SLOT(nextDiffSlot()));
+
+  prevDiffItem_ = new CQMenuItem(diffMenu_, "Prev Diff");
+
+  prevDiffItem_->setStatusTip("Move to previous difference");
+  prevDiffItem_->setIcon(CQPixmapCacheInst->getIcon("PREV_DIFF"));
+
+  prevDiffItem_->connect(this, SLOT(prevDiffSlot()));
+
+  moveDiffItem_ = new CQMenuItem(diffMenu_, "Moved Block Diff");
+
+  moveDiffItem_->setStatusTip("Move to other location of block moved in difference");
+
+  moveDiffItem_->connect(this, SLOT(moveDiffSlot()));
+
+  whiteSpaceItem_ = new CQMenuItem(diffMenu_, "Ignore White Space", CQMenuItem::CHECKABLE);
+
+  whiteSpaceItem_->setStatusTip("Ignore all white space");
+
+  whiteSpaceItem_->connect(this, SLOT(whiteSpaceSlot(bool)));
+
+  spaceChangeItem_ = new CQMenuItem(diffMenu_, "Ignore White Space Amount",
+                                    CQMenuItem::CHECKABLE);
+
+  spaceChangeItem_->setStatusTip("Ignore changes in the amount of white space");
+
+  spaceChangeItem_->connect(this, SLOT(spaceChangeSlot(bool)));
+
+  trailingSpaceItem_ = new CQMenuItem(diffMenu_, "Ignore Trailing White Space",
+                                      CQMenuItem::CHECKABLE);
+
+  trailingSpaceItem_->setStatusTip("Ignore white space at line end");
+
+  trailingSpaceItem_->connect(this, SLOT(trailingSpaceSlot(bool)));
+
+  ignoreCaseItem_ = new CQMenuItem(diffMenu_, "Ignore Case", CQMenuItem::CHECKABLE);
+
+  ignoreCaseItem_->setStatusTip("Ignore case differences");
+
+  ignoreCaseItem_->connect(this, SLOT(ignoreCaseSlot(bool)));
+
+  ignoreCRItem_ = new CQMenuItem(diffMenu_, "Ignore CR at Line End", CQMenuItem::CHECKABLE);
+
+  ignoreCRItem_->setStatusTip("Ignore carriage return at line end (CR/LF line endings)");
+
+  ignoreCRItem_->connect(this, SLOT(ignoreCRSlot(bool)));
+
+  editMaskItem_ = new CQMenuItem(diffMenu_, "Mask Rules...");
+
+  editMaskItem_->setStatusTip("Edit regex rules to mask text or ignore lines");
+
+  editMaskItem_->connect(this, SLOT(editMaskSlot()));
+
+  loadMaskItem_ = new CQMenuItem(diffMenu_, "Load Mask Preset...");
+
+  loadMaskItem_->setStatusTip("Use named mask rules");
+
+  loadMaskItem_->connect(this, SLOT(loadMaskPresetSlot()));
+
+  saveMaskItem_ = new CQMenuItem(diffMenu_, "Save Mask Preset...");
+
+  saveMaskItem_->setStatusTip("Save current mask rules with a name");
+
+  saveMaskItem_->connect(this, SLOT(saveMaskPresetSlot()));
+
+  myersItem_ = new CQMenuItem(diffMenu_, "Myers Diff", CQMenuItem::CHECKED);
+
+  myersItem_->setStatusTip("Use Myers diff algorithm");
+
+  myersItem_->connect(this, SLOT(myersSlot()));
+
+  patienceItem_ = new CQMenuItem(diffMenu_, "Patience Diff", CQMenuItem::CHECKABLE);
+
+  patienceItem_->setStatusTip("Use patience diff algorithm (anchor on unique lines)");
+
+  patienceItem_->connect(this, SLOT(patienceSlot()));
+
+  histogramItem_ = new CQMenuItem(diffMenu_, "Histogram Diff", CQMenuItem::CHECKABLE);
+
+  histogramItem_->setStatusTip("Use histogram diff algorithm (anchor on low occurrence lines)");
+
+  histogramItem_->connect(this, SLOT(histogramSlot()));
+
+  externalDiffItem_ = new CQMenuItem(diffMenu_, "External Diff", CQMenuItem::CHECKABLE);
+
+  externalDiffItem_->setStatusTip("Use external diff command instead of builtin diff");
+
+  externalDiffItem_->connect(this, SLOT(externalDiffSlot(bool)));
+
+  detectMovesItem_ = new CQMenuItem(diffMenu_, "Detect Moved Blocks", CQMenuItem::CHECKED);
+
+  detectMovesItem_->setStatusTip("Match deleted and added blocks of lines as moves");
+
+  detectMovesItem_->connect(this, SLOT(detectMovesSlot(bool)));
+
+  recompItem_ = new CQMenuItem(diffMenu_, "Recompute Diff");
+
+  recompItem_->setStatusTip("Recompute differences");
+  recompItem_->setIcon(CQPixmapCacheInst->getIcon("RELOAD"));
+
+  recompItem_->connect(this, SLOT(recomputeSlot()));
+
+  cancelItem_ = new CQMenuItem(diffMenu_, "Cancel");
+
+  cancelItem_->setShortcut("Escape");
+  cancelItem_->setStatusTip("Cancel loading/computing differences");
+  cancelItem_->setEnabled(false);
+
+  cancelItem_->connect(this, SLOT(cancelSlot()));
+
+  //--------
+
+  viewMenu_ = new CQMenu(this, "View");
 
   showLineNumbersItem_ = new CQMenuItem(viewMenu_, "Show Line Numbers", CQMenuItem::CHECKED);
 
-  showLineNumbersItem_->setStatusTip("Show Line Numbers");
+  showLineNumbersItem_->setStatusTip("Show Line Numbers");
+
+  showLineNumbersItem_->connect(this, SLOT(showLineNumbersSlot(bool)));
+
+  inlineDiffItem_ = new CQMenuItem(viewMenu_, "Inline Diff", CQMenuItem::CHECKED);
+
+  inlineDiffItem_->setStatusTip("Highlight changed words in changed lines");
+
+  inlineDiffItem_->connect(this, SLOT(inlineDiffSlot(bool)));
+
+  inlineCharItem_ = new CQMenuItem(viewMenu_, "Character Inline Diff", CQMenuItem::CHECKABLE);
+
+  inlineCharItem_->setStatusTip("Highlight changed characters instead of words");
+
+  inlineCharItem_->connect(this, SLOT(inlineCharSlot(bool)));
+
+  //----
+
+  helpMenu_ = new CQMenu(this, "Help");
+
+  CQMenuItem *aboutItem = new CQMenuItem(helpMenu_, "About");
+
+  aboutItem->setStatusTip("Show the application's About box");
+
+  aboutItem->connect(this, SLOT(aboutSlot()));
+}
+
+void
+CQDiff::
+createToolBars()
+{
+  diffToolBar_ = new CQToolBar(this, "Diff");
+
+  diffCombo_ = new CQDiffCombo(this);
+
+  diffToolBar_->addWidget(diffCombo_);
+
+  diffFilter_ = new QLineEdit;
+
+  diffFilter_->setObjectName("diffFilter");
+  diffFilter_->setPlaceholderText("Filter (e.g. c 120)");
+  diffFilter_->setToolTip("Filter changes by type (a, c, d), moved (m) and/or line number");
+
+  connect(diffFilter_, SIGNAL(textChanged(const QString &)),
+          diffCombo_, SLOT(filterSlot(const QString &)));
+  connect(diffFilter_, SIGNAL(returnPressed()), diffCombo_, SLOT(selectFirstSlot()));
+
+  diffToolBar_->addWidget(diffFilter_);
+
+  diffToolBar_->addItem(firstDiffItem_);
+  diffToolBar_->addItem(lastDiffItem_);
+  diffToolBar_->addItem(nextDiffItem_);
+  diffToolBar_->addItem(prevDiffItem_);
+  diffToolBar_->addItem(recompItem_);
+  diffToolBar_->addItem(cancelItem_);
+}
+
+void
+CQDiff::
+createStatusBar()
+{
+  statusBar()->setObjectName("status");
+
+  lslabel_ = new QLabel; lslabel_->setObjectName("lslabel");
+  rslabel_ = new QLabel; rslabel_->setObjectName("rslabel");
+
+  statusBar()->addWidget(lslabel_);
+  statusBar()->addWidget(rslabel_);
+}
+
+void
+CQDiff::
+firstDiffSlot()
+{
+  setChangeNum(0);
+}
+
+void
+CQDiff::
+lastDiffSlot()
+{
+  setChangeNum(int(changes_.size() - 1));
+}
+
+void
+CQDiff::
+nextDiffSlot()
+{
+  if (changeNum_ < int(changes_.size() - 1))
+    setChangeNum(int(changeNum_ + 1));
+}
+
+void
+CQDiff::
+prevDiffSlot()
+{
+  if (changeNum_ > 0)
+    setChangeNum(changeNum_ - 1);
+}
+
+void
+CQDiff::
+moveDiffSlot()
+{
+  if (changeNum_ < 0 || changeNum_ >= getNumChanges())
+    return;
+
+  int moveChange = this->moveChange(changeNum_);
+
+  if (moveChange >= 0)
+    setChangeNum(moveChange);
+}
+
+void
+CQDiff::
+whiteSpaceSlot(bool b)
+{
+  setIgnoreFlag(CDiffEngine::IGNORE_ALL_SPACE, b);
+
+  // diff loaded lines (normalized lines are cached per flags)
+  exec();
+}
+
+void
+CQDiff::
+spaceChangeSlot(bool b)
+{
+  setIgnoreFlag(CDiffEngine::IGNORE_SPACE_CHANGE, b);
+
+  exec();
+}
+
+void
+CQDiff::
+trailingSpaceSlot(bool b)
+{
+  setIgnoreFlag(CDiffEngine::IGNORE_TRAILING_SPACE, b);
+
+  exec();
+}
+
+void
+CQDiff::
+ignoreCaseSlot(bool b)
+{
+  setIgnoreFlag(CDiffEngine::IGNORE_CASE, b);
+
+  exec();
+}
+
+void
+CQDiff::
+ignoreCRSlot(bool b)
+{
+  setIgnoreFlag(CDiffEngine::IGNORE_CR, b);
+
+  exec();
+}
+
+void
+CQDiff::
+myersSlot()
+{
+  updateAlgorithm(Algorithm::MYERS);
+}
+
+void
+CQDiff::
+patienceSlot()
+{
+  updateAlgorithm(Algorithm::PATIENCE);
+}
+
+void
+CQDiff::
+histogramSlot()
+{
+  updateAlgorithm(Algorithm::HISTOGRAM);
+}
+
+void
+CQDiff::
+updateAlgorithm(const Algorithm &algorithm)
+{
+  setAlgorithm(algorithm);
+
+  // algorithm items are exclusive
+  myersItem_    ->getAction()->setChecked(algorithm == Algorithm::MYERS);
+  patienceItem_ ->getAction()->setChecked(algorithm == Algorithm::PATIENCE);
+  histogramItem_->getAction()->setChecked(algorithm == Algorithm::HISTOGRAM);
+
+  if (! isExternalDiff())
+    recomputeSlot();
+}
+
+void
+CQDiff::
+externalDiffSlot(bool b)
+{
+  setExternalDiff(b);
+
+  updateMaskItems();
+
+  recomputeSlot();
+}
+
+// mask rules are only applied by builtin diff
+void
+CQDiff::
+updateMaskItems()
+{
+  bool enabled = ! isExternalDiff();
+
+  editMaskItem_->setEnabled(enabled);
+  loadMaskItem_->setEnabled(enabled);
+  saveMaskItem_->setEnabled(enabled);
+}
+
+void
+CQDiff::
+detectMovesSlot(bool b)
+{
+  setDetectMoves(b);
+
+  // running diff or incomplete result needs a full diff
+  if (job_ || ! resultState_.complete) {
+    exec();
+    return;
+  }
+
+  if (b) {
+    // find moves of current changes in background
+    startJob(/*reload*/false, /*incremental*/false, /*movesOnly*/true);
+  }
+  else {
+    resultState_.detectMoves = false;
+
+    if (! moves_.empty()) {
+      moves_.clear();
+
+      updateMoves();
+    }
+
+    rslabel_->setText(QString("%1 differences").arg(getNumChanges()));
+  }
+}
+
+void
+CQDiff::
+recomputeSlot()
+{
+  // reload files and diff
+  startJob(/*reload*/true);
+}
+
+void
+CQDiff::
+autoReloadSlot(bool b)
+{
+  setAutoReload(b);
+}
+
+void
+CQDiff::
+fileChangedSlot(const QString &)
+{
+  // restart delay so a burst of writes is only reloaded once
+  reloadTimer_->start();
+}
+
+void
+CQDiff::
+reloadSlot()
+{
+  // file replaced by rename is no longer watched (and may not exist yet)
+  if (! watchFiles()) {
+    lslabel_->setText("Waiting for files ...");
+
+    reloadTimer_->start();
+    return;
+  }
+
+  // only diff changed lines if current result is complete for current settings
+  bool incremental = (! job_ && ! isExternalDiff() && resultState_.complete &&
+                      resultState_.algorithm   == algorithm() &&
+                      resultState_.ignoreFlags == ignoreFlags() &&
+                      resultState_.mask        == mask_ &&
+                      resultState_.detectMoves == isDetectMoves());
+
+  startJob(/*reload*/true, incremental);
+}
+
+void
+CQDiff::
+showLineNumbersSlot(bool b)
+{
+  ledit_->setShowNumbers(b);
+  redit_->setShowNumbers(b);
+
+  ledit_->update();
+  redit_->update();
+}
+
+void
+CQDiff::
+inlineDiffSlot(bool b)
+{
+  setInlineDiff(b);
+}
+
+void
+CQDiff::
+inlineCharSlot(bool b)
+{
+  setInlineMode(b ? CDiffInline::Mode::CHAR : CDiffInline::Mode::WORD);
+}
+
+void
+CQDiff::
+editMaskSlot()
+{
+  QString text = QString::fromStdString(mask_->text());
+
+  for (;;) {
+    bool ok;
+
+    text = QInputDialog::getMultiLineText(this, "Mask Rules",
+             "One rule per line: 'mask <regex>' or 'ignore <regex>'", text, &ok);
+
+    if (! ok)
+      return;
+
+    std::string msg;
+
+    if (setMaskText(text.toStdString(), msg))
+      break;
+
+    QMessageBox::warning(this, "Invalid Mask Rules", QString::fromStdString(msg));
+  }
+
+  exec();
+}
+
+void
+CQDiff::
+loadMaskPresetSlot()
+{
+  QStringList names;
+
+  names << "None";
+
+  for (const auto &name : maskPresetNames())
+    names << name;
+
+  bool ok;
+
+  QString name = QInputDialog::getItem(this, "Load Mask Preset", "Preset", names, 0,
+                                       /*editable*/false, &ok);
+
+  if (! ok)
+    return;
+
+  std::string msg;
+
+  if (! setMaskText(name == "None" ? "" : maskPresetText(name).toStdString(), msg)) {
+    QMessageBox::warning(this, "Invalid Mask Rules", QString::fromStdString(msg));
+    return;
+  }
+
+  exec();
+}
+
+void
+CQDiff::
+saveMaskPresetSlot()
+{
+  bool ok;
+
+  QString name = QInputDialog::getText(this, "Save Mask Preset", "Name", QLineEdit::Normal,
+                                       "", &ok);
+
+  if (! ok || name.isEmpty())
+    return;
+
+  saveMaskPreset(name, QString::fromStdString(mask_->text()));
+}
+
+bool
+CQDiff::
+setMaskText(const std::string &text, std::string &msg)
+{
+  // new rules object as running jobs use the old one
+  auto mask = std::make_shared<CDiffMask>();
+
+  if (! mask->setText(text, msg))
+    return false;
+
+  mask_ = mask;
+
+  return true;
+}
+
+QStringList
+CQDiff::
+maskPresetNames() const
+{
+  QStringList names;
+
+  for (const auto &preset : CDiffMask::presets())
+    names << QString::fromStdString(preset.name);
+
+  QSettings settings("CQDiff", "CQDiff");
+
+  settings.beginGroup("MaskPresets");
+
+  for (const auto &name : settings.childKeys()) {
+    if (! names.contains(name))
+      names << name;
+  }
+
+  settings.endGroup();
+
+  return names;
+}
+
+QString
+CQDiff::
+maskPresetText(const QString &name) const
+{
+  // saved preset replaces builtin preset of same name
+  QSettings settings("CQDiff", "CQDiff");
+
+  settings.beginGroup("MaskPresets");
+
+  QVariant value = settings.value(name);
+
+  settings.endGroup();
+
+  if (value.isValid())
+    return value.toString();
 
-  showLineNumbersItem_->connect(this, SLOT(showLineNumbersSlot(bool)));
+  for (const auto &preset : CDiffMask::presets()) {
+    if (QString::fromStdString(preset.name) == name)
+      return QString::fromStdString(preset.text);
+  }
 
-  //----
+  return "";
+}
 
-  helpMenu_ = new CQMenu(this, "Help");
+void
+CQDiff::
+saveMaskPreset(const QString &name, const QString &text)
+{
+  QSettings settings("CQDiff", "CQDiff");
 
-  CQMenuItem *aboutItem = new CQMenuItem(helpMenu_, "About");
+  settings.beginGroup("MaskPresets");
 
-  aboutItem->setStatusTip("Show the application's About box");
+  settings.setValue(name, text);
 
-  aboutItem->connect(this, SLOT(aboutSlot()));
+  settings.endGroup();
 }
 
 void
 CQDiff::
-createToolBars()
+aboutSlot()
 {
-  diffToolBar_ = new CQToolBar(this, "Diff");
+}
 
-  diffCombo_ = new CQDiffCombo(this);
+void
+CQDiff::
+setAutoReload(bool b)
+{
+  autoReload_ = b;
 
-  diffToolBar_->addWidget(diffCombo_);
+  watchFiles();
 
-  diffToolBar_->addItem(firstDiffItem_);
-  diffToolBar_->addItem(lastDiffItem_);
-  diffToolBar_->addItem(nextDiffItem_);
-  diffToolBar_->addItem(prevDiffItem_);
-  diffToolBar_->addItem(recompItem_);
+  if (! autoReload_)
+    reloadTimer_->stop();
 }
 
-void
+bool
 CQDiff::
-createStatusBar()
+watchFiles()
 {
-  statusBar()->setObjectName("status");
+  QStringList fileNames;
 
-  lslabel_ = new QLabel; lslabel_->setObjectName("lslabel");
-  rslabel_ = new QLabel; rslabel_->setObjectName("rslabel");
+  bool allExist = true;
 
-  statusBar()->addWidget(lslabel_);
-  statusBar()->addWidget(rslabel_);
+  if (isAutoReload()) {
+    for (const auto &fileName : { ledit_->getFileName(), redit_->getFileName() }) {
+      if (! QFileInfo::exists(fileName)) {
+        allExist = false;
+        continue;
+      }
+
+      if (! fileNames.contains(fileName))
+        fileNames << fileName;
+    }
+  }
+
+  QStringList watched = watcher_->files();
+
+  for (const auto &fileName : watched) {
+    if (! fileNames.contains(fileName))
+      watcher_->removePath(fileName);
+  }
+
+  for (const auto &fileName : fileNames) {
+    if (! watched.contains(fileName))
+      watcher_->addPath(fileName);
+  }
+
+  return allExist;
 }
 
-void
+int
 CQDiff::
-firstDiffSlot()
+moveChange(int i) const
 {
-  setChangeNum(0);
+  // deleted lines moved to right or added lines moved from left
+  int move = moves_.changeMove(CSIDE_TYPE_LEFT, i);
+
+  if (move >= 0)
+    return moves_.move(move).rchange;
+
+  move = moves_.changeMove(CSIDE_TYPE_RIGHT, i);
+
+  if (move >= 0)
+    return moves_.move(move).lchange;
+
+  return -1;
 }
 
+//---
+
 void
 CQDiff::
-lastDiffSlot()
+setInlineDiff(bool b)
 {
-  setChangeNum(int(changes_.size() - 1));
+  inlineDiff_ = b;
+
+  clearInlineDiffs();
+
+  ledit_->update();
+  redit_->update();
 }
 
 void
 CQDiff::
-nextDiffSlot()
+setInlineMode(const CDiffInline::Mode &mode)
 {
-  if (changeNum_ < int(changes_.size() - 1))
-    setChangeNum(int(changeNum_ + 1));
+  inlineMode_ = mode;
+
+  clearInlineDiffs();
+
+  ledit_->update();
+  redit_->update();
 }
 
 void
 CQDiff::
-prevDiffSlot()
+clearInlineDiffs()
 {
-  if (changeNum_ > 0)
-    setChangeNum(changeNum_ - 1);
+  inlineDiffs_.clear();
+
+  // drop results of running inline diffs and redraw tiles
+  ++inlineGeneration_;
+  ++inlineId_;
+
+  if (inlineWorker_)
+    inlineWorker_->generation = inlineGeneration_;
 }
 
 void
 CQDiff::
-whiteSpaceSlot(bool b)
+requestInlineDiffs(int row1, int row2)
 {
-  setIgnoreWhiteSpace(b);
+  if (! isInlineDiff() || changes_.empty() || ! lines_)
+    return;
 
-  recomputeSlot();
+  row1 = std::max(row1, 0);
+  row2 = std::min(row2, rows_.numRows() - 1);
+
+  if (row1 > row2)
+    return;
+
+  int c1 = std::max(rows_.rowChange(row1), 0);
+  int c2 = rows_.rowChange(row2);
+
+  // line pairs of changes not diffed yet
+  InlineWorker::Tasks tasks;
+
+  for (int i = c1; i <= c2; ++i) {
+    if (changes_.type(i) != 'c' || inlineDiffs_.find(i) != inlineDiffs_.end())
+      continue;
+
+    // mark as being diffed
+    inlineDiffs_[i] = InlineDiffP();
+
+    InlineWorker::Task task;
+
+    task.change = i;
+    task.lfirst = changes_.first(CSIDE_TYPE_LEFT , i);
+    task.rfirst = changes_.first(CSIDE_TYPE_RIGHT, i);
+    task.npairs = std::min({changes_.len(CSIDE_TYPE_LEFT , i),
+                            changes_.len(CSIDE_TYPE_RIGHT, i), maxInlinePairs()});
+
+    tasks.push_back(task);
+  }
+
+  if (tasks.empty())
+    return;
+
+  //---
+
+  // diff on worker thread so drawing never waits
+  if (! inlineWorker_) {
+    inlineWorker_ = std::make_unique<InlineWorker>();
+
+    inlineWorker_->generation = inlineGeneration_;
+
+    inlineWorker_->thread = std::thread(&CQDiff::inlineWorkerLoop, this);
+  }
+
+  InlineWorker::Request request;
+
+  request.lines      = lines_;
+  request.mode       = inlineMode();
+  request.generation = inlineGeneration_;
+  request.tasks      = std::move(tasks);
+
+  {
+    std::lock_guard<std::mutex> lock(inlineWorker_->mutex);
+
+    inlineWorker_->requests.push_back(std::move(request));
+  }
+
+  inlineWorker_->cond.notify_one();
 }
 
+// diff queued inline diff requests (worker thread)
 void
 CQDiff::
-recomputeSlot()
+inlineWorkerLoop()
 {
-  ledit_->setFileName(ledit_->getFileName());
-  redit_->setFileName(redit_->getFileName());
+  auto &worker = *inlineWorker_;
 
-  exec();
+  while (true) {
+    InlineWorker::Request request;
 
-  ledit_->update();
-  redit_->update();
+    {
+      std::unique_lock<std::mutex> lock(worker.mutex);
+
+      worker.cond.wait(lock, [&]() { return worker.stop || ! worker.requests.empty(); });
+
+      if (worker.stop)
+        return;
+
+      request = std::move(worker.requests.front());
+
+      worker.requests.pop_front();
+    }
+
+    auto isCurrent = [&]() {
+      return (! worker.stop && request.generation == worker.generation);
+    };
+
+    ChangeInlineDiffs diffs;
+
+    for (const auto &task : request.tasks) {
+      auto diff = std::make_shared<InlineDiff>();
+
+      diff->lspans.resize(size_t(task.npairs));
+      diff->rspans.resize(size_t(task.npairs));
+
+      for (int k = 0; k < task.npairs && isCurrent(); ++k)
+        (void) CDiffInline::diffLines(request.lines->text(CSIDE_TYPE_LEFT , task.lfirst + k),
+                                      request.lines->text(CSIDE_TYPE_RIGHT, task.rfirst + k),
+                                      request.mode, diff->lspans[size_t(k)],
+                                      diff->rspans[size_t(k)]);
+
+      if (! isCurrent())
+        break;
+
+      diffs.push_back(ChangeInlineDiff(task.change, diff));
+    }
+
+    if (! isCurrent())
+      continue;
+
+    // queued events of deleted window are discarded (thread is joined before then)
+    auto generation = request.generation;
+
+    QMetaObject::invokeMethod(this, [this, generation, diffs]() {
+      inlineDiffsFinished(generation, diffs);
+    }, Qt::QueuedConnection);
+  }
 }
 
+// store inline diff results and redraw their tiles (gui thread)
 void
 CQDiff::
-showLineNumbersSlot(bool b)
+inlineDiffsFinished(uint generation, const ChangeInlineDiffs &diffs)
 {
-  ledit_->setShowNumbers(b);
-  redit_->setShowNumbers(b);
+  // drop result of cleared inline diffs
+  if (generation != inlineGeneration_)
+    return;
 
-  ledit_->update();
-  redit_->update();
+  for (const auto &diff : diffs) {
+    inlineDiffs_[diff.first] = diff.second;
+
+    int row1 = rows_.changeRow(diff.first);
+    int row2 = row1 + rows_.changeNumRows(diff.first) - 1;
+
+    ledit_->invalidateRows(row1, row2);
+    redit_->invalidateRows(row1, row2);
+  }
 }
 
-void
+const CDiffInline::Spans *
 CQDiff::
-aboutSlot()
+inlineSpans(CSideType side, int change, int line) const
 {
+  auto p = inlineDiffs_.find(change);
+
+  if (p == inlineDiffs_.end() || ! (*p).second)
+    return nullptr;
+
+  const auto &spans = (side == CSIDE_TYPE_LEFT ? (*p).second->lspans : (*p).second->rspans);
+
+  int k = line - changes_.first(side, change);
+
+  if (k < 0 || k >= int(spans.size()))
+    return nullptr;
+
+  return &spans[size_t(k)];
 }
 
 void
@@ -387,6 +1820,10 @@ setChangeNum(int changeNum)
   changeNum_ = changeNum;
 
   emit changeNumChanged();
+
+  // redraw selected change
+  ledit_->update();
+  redit_->update();
 }
 
 void
@@ -396,19 +1833,9 @@ scrollToChange()
   if (changeNum_ < 0 || changeNum_ >= getNumChanges())
     return;
 
-  const CQDiffChange &change = getChange(changeNum_);
-
-  int loffset = change.getOffset(CSIDE_TYPE_LEFT);
-  int roffset = change.getOffset(CSIDE_TYPE_RIGHT);
+  auto change = getChange(changeNum_);
 
-  int offset = 0;
-
-  if      (loffset >= 0 && roffset >= 0)
-    offset = (loffset + roffset)/2;
-  else if (loffset >= 0)
-    offset = loffset;
-  else
-    offset = roffset;
+  int offset = rows_.changeRow(changeNum_)*ledit_->charHeight();
 
   offset -= vbar_->pageStep()/3;
 
@@ -420,18 +1847,27 @@ scrollToChange()
 
   vbar_->setValue(offset);
 
+  updateDiffItems();
+
+  lslabel_->setText(change.getString().c_str());
+}
+
+void
+CQDiff::
+updateDiffItems()
+{
   firstDiffItem_->setEnabled(changeNum_ > 0);
   lastDiffItem_ ->setEnabled(changeNum_ < int(changes_.size()) - 1);
   nextDiffItem_ ->setEnabled(changeNum_ < int(changes_.size()) - 1);
   prevDiffItem_ ->setEnabled(changeNum_ > 0);
-
-  lslabel_->setText(change.getString().c_str());
+  moveDiffItem_ ->setEnabled(moveChange(changeNum_) >= 0);
 }
 
 void
 CQDiff::
-setDataHeight(int dataHeight)
+updateDataHeight()
 {
+  int dataHeight   = rows_.numRows()*ledit_->charHeight();
   int scrollHeight = vbar_->height();
 
   if (dataHeight == dataHeight_ && scrollHeight == scrollHeight_)
@@ -456,12 +1892,67 @@ updateVBar()
 
   vbar_->setSingleStep(scrollHeight_/10);
 
-  vbar_->setValue(0);
-
   ledit_->updateScrollbars(dataHeight_);
   redit_->updateScrollbars(dataHeight_);
 }
 
+void
+CQDiff::
+drawTiles(CQFileEdit *edit, int ind1, int ind2)
+{
+  struct TileJob {
+    CQFileEdit *edit { nullptr };
+    int         ind  { 0 };
+    QImage      image;
+  };
+
+  std::vector<TileJob> jobs;
+
+  auto addJobs = [&](CQFileEdit *edit, int ind1, int ind2) {
+    for (int ind = ind1; ind <= ind2; ++ind) {
+      if (! edit->hasTile(ind)) {
+        TileJob job;
+
+        job.edit = edit;
+        job.ind  = ind;
+
+        jobs.push_back(job);
+      }
+    }
+  };
+
+  addJobs(edit, ind1, ind2);
+
+  // other file is drawn next (same rows) so draw its visible tiles now
+  CQFileEdit *other = (edit == ledit_ ? redit_ : ledit_);
+
+  if (! other->prepareDraw())
+    other->canvas()->update();
+
+  int oind1, oind2;
+
+  other->tileRange(other->canvasRect(), oind1, oind2);
+
+  addJobs(other, oind1, oind2);
+
+  if (jobs.empty())
+    return;
+
+  //---
+
+  // draw tile images on worker threads (tile drawing only reads state)
+  CDiffThreadPool::Tasks tasks;
+
+  for (auto &job : jobs)
+    tasks.push_back([&job]() { job.image = job.edit->drawTile(job.ind); });
+
+  renderPool_->run(tasks);
+
+  // add to tile caches (gui thread)
+  for (auto &job : jobs)
+    job.edit->addTile(job.ind, job.image);
+}
+
 void
 CQDiff::
 scrollSlot(int y)
@@ -511,231 +2002,401 @@ CQFileEdit(CQDiff *diff, CSideType side, const QString &fileName) :
 
   connect(vbar_, SIGNAL(valueChanged(int)), this, SLOT(vscrollSlot(int)));
   connect(hbar_, SIGNAL(valueChanged(int)), this, SLOT(hscrollSlot(int)));
+
+  updateCharSize();
+}
+
+void
+CQFileEdit::
+setFileName(const QString &fileName)
+{
+  // lines are loaded (in background) by diff
+  fileName_ = fileName;
+}
+
+const CQFileEdit::LineIds &
+CQFileEdit::
+getLineIds() const
+{
+  return diff_->lines().ids(side_);
+}
+
+int
+CQFileEdit::
+numLines() const
+{
+  return diff_->lines().numLines(side_);
+}
+
+std::string_view
+CQFileEdit::
+getLine(int i) const
+{
+  return diff_->lines().text(side_, i);
+}
+
+void
+CQFileEdit::
+hscrollSlot(int x)
+{
+  x_offset_ = -x;
+
+  canvas_->update();
+}
+
+void
+CQFileEdit::
+vscrollSlot(int y)
+{
+  int dy = -y - y_offset_;
+
+  y_offset_ = -y;
+
+  // move drawn pixels and only draw exposed rows
+  canvas_->scroll(0, dy);
+}
+
+void
+CQFileEdit::
+updateCharSize()
+{
+  QFontMetrics fm(canvas_->font());
+
+  charWidth_  = fm.averageCharWidth();
+  charHeight_ = fm.height();
+  charAscent_ = fm.ascent();
+}
+
+void
+CQFileEdit::
+draw(QPainter *p, const QRect &rect)
+{
+  // scrolled pixels are out of date if state changed
+  if (! prepareDraw() && rect != canvasRect())
+    canvas_->update();
+
+  //---
+
+  // draw missing tiles covering rect of both files
+  int ind1, ind2;
+
+  tileRange(rect, ind1, ind2);
+
+  // inline diff changes near visible tiles (drawn when ready)
+  diff_->requestInlineDiffs((ind1 - 1)*tileRows(), (ind2 + 2)*tileRows() - 1);
+
+  diff_->drawTiles(this, ind1, ind2);
+
+  // draw tiles
+  int th = tileRows()*charHeight_;
+
+  for (int ind = ind1; ind <= ind2; ++ind) {
+    QPixmap pixmap;
+
+    // tile evicted (small cache)
+    if (! tiles_.get(ind, pixmap)) {
+      pixmap = QPixmap::fromImage(drawTile(ind));
+
+      tiles_.add(ind, pixmap);
+    }
+
+    p->drawPixmap(0, y_offset_ + ind*th, pixmap);
+  }
+}
+
+// update draw state before drawing tiles (returns false if tiles were cleared)
+bool
+CQFileEdit::
+prepareDraw()
+{
+  updateCharSize();
+
+  atlas_.update(canvas_->font(), diff_->fgColor(), canvas_->devicePixelRatioF());
+
+  tiles_.setMaxBytes(int64_t(diff_->tileCacheSize())*1024*1024);
+
+  return updateTileState();
+}
+
+QWidget *
+CQFileEdit::
+canvas() const
+{
+  return canvas_;
+}
+
+QRect
+CQFileEdit::
+canvasRect() const
+{
+  return canvas_->rect();
 }
 
+// range of tiles covering canvas rect
 void
 CQFileEdit::
-setFileName(const QString &fileName)
+tileRange(const QRect &rect, int &ind1, int &ind2) const
 {
-  fileName_ = fileName;
-
-  lines_.clear();
+  int th = tileRows()*charHeight_;
 
-  CFile file(fileName_.toStdString());
+  int y1 = std::max(rect.top   () - y_offset_, 0);
+  int y2 = std::max(rect.bottom() - y_offset_, 0);
 
-  if (! file.isRegular()) return;
-
-  file.toLines(lines_);
+  ind1 = y1/th;
+  ind2 = y2/th;
 }
 
-void
+bool
 CQFileEdit::
-reset()
+hasTile(int ind) const
 {
-  changeMap_.clear();
+  return tiles_.contains(ind);
 }
 
 void
 CQFileEdit::
-addChange(uint num, char c, int start, int end)
+addTile(int ind, const QImage &image)
 {
-  changeMap_[start] = Change(num, c, start, end);
+  tiles_.add(ind, QPixmap::fromImage(image));
 }
 
 void
 CQFileEdit::
-hscrollSlot(int x)
+invalidateRows(int row1, int row2)
 {
-  x_offset_ = -x;
+  if (row2 < row1)
+    return;
+
+  for (int ind = row1/tileRows(); ind <= row2/tileRows(); ++ind)
+    tiles_.remove(ind);
 
   canvas_->update();
 }
 
-void
+// update tile state and clear tiles if anything drawn in them has changed (returns
+// false if changed)
+bool
 CQFileEdit::
-vscrollSlot(int y)
+updateTileState()
 {
-  y_offset_ = -y;
-
-  canvas_->update();
+  TileState state;
+
+  state.font        = canvas_->font();
+  state.pixelRatio  = canvas_->devicePixelRatioF();
+  state.width       = canvas_->width();
+  state.xOffset     = x_offset_;
+  state.showNumbers = isShowNumbers();
+  state.changeNum   = diff_->getChangeNum();
+  state.resultId    = diff_->resultId();
+  state.inlineId    = diff_->inlineId();
+  state.bg          = diff_->bgColor();
+  state.fg          = diff_->fgColor();
+  state.border      = diff_->borderColor();
+  state.add         = diff_->getChangeColor(side_, 'a');
+  state.change      = diff_->getChangeColor(side_, 'c');
+  state.del         = diff_->getChangeColor(side_, 'd');
+  state.move        = diff_->getChangeColor(side_, 'm');
+  state.selected    = diff_->selectedColor();
+
+  if (state == tileState_)
+    return true;
+
+  tileState_ = state;
+
+  tiles_.clear();
+
+  return false;
 }
 
-void
+// draw rows of tile into image (can be run on any thread as only reads state)
+QImage
 CQFileEdit::
-draw(QPainter *p)
+drawTile(int ind) const
 {
-  QFont font = canvas_->font();
+  int    width      = tileState_.width;
+  int    height     = tileRows()*charHeight_;
+  double pixelRatio = tileState_.pixelRatio;
 
-  QFontMetrics fm(font);
+  QImage image(int(width*pixelRatio), int(height*pixelRatio),
+               QImage::Format_ARGB32_Premultiplied);
 
-  int width  = canvas_->width ();
-  int height = canvas_->height();
+  image.setDevicePixelRatio(pixelRatio);
 
-  charWidth_  = fm.averageCharWidth();
-  charHeight_ = fm.height();
-  charAscent_ = fm.ascent();
+  // clear background
+  image.fill(tileState_.bg);
+
+  QPainter painter(&image);
 
-  int y1 = y_offset_;
-  int y2 = y1 + charHeight_;
+  painter.setFont(tileState_.font);
 
-  char   change_c   = '\0';
-  int    change_end = 0;
-  int    change_len = 0;
-  QColor change_bg;
+  drawRows(&painter, ind*tileRows(), (ind + 1)*tileRows() - 1, -ind*height, width, height);
 
-  auto num_lines = lines_.size();
+  return image;
+}
 
-  int         lfw = 0;
-  std::string lfmt;
+// draw rows (startRow to endRow) with row 0 at y
+void
+CQFileEdit::
+drawRows(QPainter *p, int startRow, int endRow, int y, int width, int height) const
+{
+  const auto &rows = diff_->rows();
 
-  if (isShowNumbers()) {
-    int lw = int(std::log10(num_lines) + 1);
+  auto num_lines = uint(numLines());
 
-    lfmt = "%" + CStrUtil::toString(lw) + "d";
+  int lw  = 0;
+  int lfw = 0;
 
+  if (tileState_.showNumbers) {
+    lw  = int(std::log10(num_lines) + 1);
     lfw = lw*charWidth_ + 8;
   }
 
   int iw = charWidth_ + 8;
 
-  for (uint line_num = 1; line_num <= num_lines; ++line_num, y1 = y2, y2 = y1 + charHeight_) {
-    // check if line if visible
-    bool draw = (y2 >= 0 && y1 < height);
+  //---
 
-    //-----
+  p->setPen(tileState_.fg);
 
-    int x = x_offset_;
+  endRow = std::min(endRow, rows.numRows() - 1);
 
-    if (draw) {
-      // clear background
-      p->fillRect(0, y1, width - x_offset_, charHeight_, QBrush(diff_->bgColor()));
+  for (int row = startRow; row <= endRow; ++row) {
+    int y1 = y + row*charHeight_;
+    int x  = tileState_.xOffset;
 
-      // draw line number if needed
-      if (isShowNumbers()) {
-        p->setPen(diff_->fgColor());
+    auto rowLine = rows.rowLine(side_, row);
 
-        std::string lstr = CStrUtil::strprintf(&lfmt, line_num);
+    // draw line number if needed
+    if (tileState_.showNumbers && rowLine.line >= 0) {
+      char lstr[32];
 
-        p->drawText(x, y1 + charAscent_, lstr.c_str());
-      }
+      int len = snprintf(lstr, sizeof(lstr), "%*d", lw, rowLine.line + 1);
+
+      drawText(p, x, y1, std::string_view(lstr, size_t(len)));
     }
 
     x += lfw;
 
-    int pad = 0;
+    // fill background for change color
+    char   change_c = '\0';
+    QColor change_bg;
 
-    // check for new change
-    if (! change_c) {
-      // find change for line
-      auto pc = changeMap_.find(int(line_num));
+    if (rowLine.change >= 0) {
+      const CQDiff *diff = diff_;
 
-      if (pc != changeMap_.end()) {
-        const Change &change = (*pc).second;
+      change_c = diff->getChanges().type(rowLine.change);
 
-        bool selected = (diff_->getChangeNum() == int(change.num - 1));
+      switch (change_c) {
+        case 'a': change_bg = tileState_.add   ; break;
+        case 'c': change_bg = tileState_.change; break;
+        default : change_bg = tileState_.del   ; break;
+      }
 
-        // get delta change data (both files)
-        auto &dchange = diff_->getChange(int(change.num - 1));
+      // line of moved block
+      if (rowLine.line >= 0 && diff->getMoves().lineMove(side_, rowLine.line) >= 0) {
+        change_c  = 'm';
+        change_bg = tileState_.move;
+      }
 
-        change_c   = dchange.getChar();
-        change_end = dchange.getEnd(side_);
-        change_len = dchange.getOtherLen(side_) - dchange.getLen(side_);
-        change_bg  = diff_->getChangeColor(side_, change_c);
+      if (side_ == CSIDE_TYPE_RIGHT)
+        change_c = char(toupper(change_c));
 
-        if (selected && side_ == CSIDE_TYPE_LEFT)
-          change_bg = diff_->selectedColor();
+      if (tileState_.changeNum == rowLine.change && side_ == CSIDE_TYPE_LEFT)
+        change_bg = tileState_.selected;
 
-        if (change_len > 0)
-          pad = change_len;
+      p->fillRect(x, y1, width - tileState_.xOffset, charHeight_, QBrush(change_bg));
+    }
 
-        // check this line part of change
-        if (dchange.getLen(side_) > 0) {
-          // fill background for change color
-          if (draw)
-            p->fillRect(x, y1, width - x_offset_, charHeight_, QBrush(change_bg));
-        }
-        else {
-          change_c   = '\0';
-          change_end = 0;
-        }
+    // draw change character
+    if (change_c)
+      drawText(p, x, y1, std::string_view(&change_c, 1));
 
-        // update change y position
-        dchange.setOffset(side_, y1 - y_offset_);
-      }
-    }
-    // continuation of change
-    else {
-      // reset if done
-      if (int(line_num) > change_end) {
-        change_c   = '\0';
-        change_end = 0;
-      }
-      // fill background for change color
-      else {
-        if (draw)
-          p->fillRect(x, y1, width - x_offset_, charHeight_, QBrush(change_bg));
-      }
-    }
+    x += iw;
 
-    //---
+    // draw changed words of changed line and line
+    if (rowLine.line >= 0) {
+      if (change_c == 'c' || change_c == 'C')
+        drawInlineSpans(p, x, y1, rowLine.change, rowLine.line, change_bg.darker(130));
 
-    // draw change character
-    if (draw) {
-      if (change_c)
-        p->drawText(x, y1 + charAscent_, QString(change_c));
-      else
-        p->drawText(x, y1 + charAscent_, " ");
+      drawLine(p, x, y1, rowLine.line, width);
     }
+  }
 
-    x += iw;
+  //---
 
-    //---
+  // draw border lines
+  p->setPen(tileState_.border);
 
-    // draw line
-    if (draw) {
-      const auto &line = lines_[line_num - 1];
+  int x = tileState_.xOffset + lfw - 4;
 
-      p->drawText(x, y1 + charAscent_, line.c_str());
-    }
+  p->drawLine(x, 0, x, height - 1);
+
+  x = tileState_.xOffset + lfw + iw - 4;
 
-    //---
+  p->drawLine(x, 0, x, height - 1);
+}
+
+void
+CQFileEdit::
+drawInlineSpans(QPainter *p, int x, int y, int change, int line, const QColor &c) const
+{
+  const CQDiff *diff = diff_;
 
-    for (int j = 0; j < pad; ++j) {
-      x = x_offset_;
+  auto *spans = diff->inlineSpans(side_, change, line);
 
-      y1 = y2;
-      y2 = y1 + charHeight_;
+  if (! spans)
+    return;
 
-      bool draw = (y2 >= 0 && y1 < height);
+  auto str = diff->lines().text(side_, line);
 
-      if (draw) {
-        p->fillRect(x + lfw, y1, width - x_offset_, charHeight_, QBrush(change_bg));
+  for (const auto &span : *spans) {
+    int col1 = CDiffFile::columns(str.substr(0, size_t(span.start)));
+    int col2 = CDiffFile::columns(str.substr(0, size_t(span.start + span.len)));
 
-        if (change_c)
-          p->drawText(x + lfw, y1 + charAscent_, QString(change_c));
-        else
-          p->drawText(x + lfw, y1 + charAscent_, " ");
-      }
-    }
+    if (col2 > col1)
+      p->fillRect(x + col1*charWidth_, y, (col2 - col1)*charWidth_, charHeight_, QBrush(c));
   }
+}
 
-  //---
+void
+CQFileEdit::
+drawText(QPainter *p, int x, int y, const std::string_view &str, int col) const
+{
+  // ascii glyphs from atlas
+  if (atlas_.drawText(p, x, y, str, col))
+    return;
 
-  // draw border lines
-  p->setPen(diff_->borderColor());
+  // shape other text (tabs expanded to match atlas)
+  std::string str1 = CQGlyphAtlas::expandTabs(str, col);
 
-  int x = x_offset_ + lfw - 4;
+  p->drawText(x + col*charWidth_, y + charAscent_,
+              QString::fromUtf8(str1.data(), int(str1.size())));
+}
 
-  p->drawLine(x, 0, x, height - 1);
+void
+CQFileEdit::
+drawLine(QPainter *p, int x, int y, int line, int width) const
+{
+  const auto &lines = diff_->lines();
 
-  x = x_offset_ + lfw + iw - 4;
+  auto str = lines.text(side_, line);
 
-  p->drawLine(x, 0, x, height - 1);
+  // visible columns (extra column at each end for partially visible chars)
+  int cw = std::max(charWidth_, 1);
 
-  //---
+  int col1 = std::max(-x/cw - 1, 0);
+  int col2 = (width - x)/cw + 1;
+
+  if (col2 <= col1)
+    return;
+
+  // only lay out chars in visible columns
+  int startCol1 = 0, startCol2 = 0;
 
-  if (side_ == CSIDE_TYPE_LEFT)
-    diff_->setDataHeight(y2 - y_offset_);
+  size_t pos1 = lines.columnPos(side_, line, col1, startCol1);
+  size_t pos2 = CDiffColumnIndex::scanColumn(str, pos1, startCol1, col2, startCol2);
+
+  if (pos2 > pos1)
+    drawText(p, x, y, str.substr(pos1, pos2 - pos1), startCol1);
 }
 
 void
@@ -749,14 +2410,14 @@ updateScrollbars(int height)
 
   QFontMetrics fm(font);
 
-  charWidth_ = fm.averageCharWidth();
+  updateCharSize();
 
-  auto num_lines = lines_.size();
+  auto num_lines = getLineIds().size();
 
-  int width = 0;
+  // max line columns computed on load (use widest char if font is not monospace)
+  int cw = (QFontInfo(font).fixedPitch() ? charWidth_ : fm.maxWidth());
 
-  for (const auto &line : lines_)
-    width = std::max(width, fm.horizontalAdvance(line.c_str()));
+  int width = diff_->lines().maxColumns(side_)*cw;
 
   int lw = int(std::log10(num_lines) + 1);
 
@@ -802,21 +2463,219 @@ CQFileEditCanvas(CQFileEdit *edit) :
 
 void
 CQFileEditCanvas::
-paintEvent(QPaintEvent *)
+paintEvent(QPaintEvent *e)
 {
   QPainter painter(this);
 
-  edit_->draw(&painter);
+  edit_->draw(&painter, e->rect());
 }
 
 //------
 
+CQDiffChangeModel::
+CQDiffChangeModel(CQDiff *diff, QObject *parent) :
+ QAbstractListModel(parent), diff_(diff)
+{
+}
+
+int
+CQDiffChangeModel::
+rowCount(const QModelIndex &parent) const
+{
+  if (parent.isValid())
+    return 0;
+
+  return (isFiltered() ? int(inds_.size()) : numChanges_);
+}
+
+QVariant
+CQDiffChangeModel::
+data(const QModelIndex &index, int role) const
+{
+  if (role != Qt::DisplayRole)
+    return QVariant();
+
+  int ind = rowChange(index.row());
+
+  if (ind < 0 || ind >= diff_->getNumChanges())
+    return QVariant();
+
+  auto change = diff_->getChange(ind);
+
+  auto str = QString("%1: %2").arg(change.getNum()).
+               arg(QString::fromStdString(change.getString()));
+
+  if (change.getMoveChange() >= 0)
+    str += QString(" (moved %1)").arg(change.getMoveChange() + 1);
+
+  return str;
+}
+
+void
+CQDiffChangeModel::
+setFilter(const QString &filter)
+{
+  if (filter == filter_)
+    return;
+
+  filter_ = filter;
+
+  // type characters and line number (ignore anything else)
+  types_ = "";
+  moved_ = false;
+  line_  = -1;
+
+  for (auto c : filter_.toStdString()) {
+    char c1 = char(tolower(c));
+
+    if      (c1 == 'a' || c1 == 'c' || c1 == 'd') {
+      if (types_.find(c1) == std::string::npos)
+        types_ += c1;
+    }
+    else if (c1 == 'm')
+      moved_ = true;
+    else if (c1 >= '0' && c1 <= '9')
+      line_ = std::max(line_, 0)*10 + (c1 - '0');
+  }
+
+  load();
+}
+
+void
+CQDiffChangeModel::
+load()
+{
+  beginResetModel();
+
+  numChanges_ = 0;
+
+  inds_.clear();
+
+  int numChanges = diff_->getNumChanges();
+
+  if (isFiltered()) {
+    for (int i = 0; i < numChanges; ++i)
+      if (acceptChange(i))
+        inds_.push_back(i);
+  }
+
+  numChanges_ = numChanges;
+
+  endResetModel();
+}
+
+void
+CQDiffChangeModel::
+append()
+{
+  int numChanges = diff_->getNumChanges();
+
+  if (numChanges <= numChanges_)
+    return;
+
+  if (isFiltered()) {
+    Inds inds;
+
+    for (int i = numChanges_; i < numChanges; ++i)
+      if (acceptChange(i))
+        inds.push_back(i);
+
+    numChanges_ = numChanges;
+
+    if (inds.empty())
+      return;
+
+    int row = int(inds_.size());
+
+    beginInsertRows(QModelIndex(), row, row + int(inds.size()) - 1);
+
+    inds_.insert(inds_.end(), inds.begin(), inds.end());
+
+    endInsertRows();
+  }
+  else {
+    beginInsertRows(QModelIndex(), numChanges_, numChanges - 1);
+
+    numChanges_ = numChanges;
+
+    endInsertRows();
+  }
+}
+
+int
+CQDiffChangeModel::
+rowChange(int row) const
+{
+  if (row < 0 || row >= rowCount())
+    return -1;
+
+  return (isFiltered() ? inds_[size_t(row)] : row);
+}
+
+int
+CQDiffChangeModel::
+changeRow(int ind) const
+{
+  if (ind < 0 || ind >= numChanges_)
+    return -1;
+
+  if (! isFiltered())
+    return ind;
+
+  // indices are sorted
+  auto p = std::lower_bound(inds_.begin(), inds_.end(), ind);
+
+  if (p == inds_.end() || *p != ind)
+    return -1;
+
+  return int(p - inds_.begin());
+}
+
+bool
+CQDiffChangeModel::
+acceptChange(int ind) const
+{
+  auto change = diff_->getChange(ind);
+
+  if (! types_.empty() && types_.find(change.getChar()) == std::string::npos)
+    return false;
+
+  if (moved_ && change.getMoveChange() < 0)
+    return false;
+
+  if (line_ >= 0) {
+    auto inRange = [&](CSideType side) {
+      return (line_ >= change.getStart(side) && line_ <= change.getEnd(side));
+    };
+
+    if (! inRange(CSIDE_TYPE_LEFT) && ! inRange(CSIDE_TYPE_RIGHT))
+      return false;
+  }
+
+  return true;
+}
+
+//-------
+
 CQDiffCombo::
 CQDiffCombo(CQDiff *diff) :
  QComboBox(nullptr), diff_(diff)
 {
   setObjectName("diffCombo");
 
+  model_ = new CQDiffChangeModel(diff_, this);
+
+  setModel(model_);
+
+  // don't size to (or lay out) every item
+  setSizeAdjustPolicy(QComboBox::AdjustToMinimumContentsLengthWithIcon);
+  setMinimumContentsLength(24);
+
+  auto *listView = qobject_cast<QListView *>(view());
+
+  if (listView)
+    listView->setUniformItemSizes(true);
+
   connect(this, SIGNAL(currentIndexChanged(int)), this, SLOT(changedSlot(int)));
 
   connect(diff_, SIGNAL(changeNumChanged()), this, SLOT(updateChangeSlot()));
@@ -824,32 +2683,79 @@ CQDiffCombo(CQDiff *diff) :
 
 void
 CQDiffCombo::
-changedSlot(int ind)
+changedSlot(int row)
 {
-  diff_->setChangeNum(ind);
+  if (updating_)
+    return;
+
+  int ind = model_->rowChange(row);
+
+  if (ind >= 0)
+    diff_->setChangeNum(ind);
 }
 
 void
 CQDiffCombo::
 updateChangeSlot()
 {
-  int changeNum = diff_->getChangeNum();
+  int row = model_->changeRow(diff_->getChangeNum());
+
+  if (row != currentIndex()) {
+    updating_ = true;
+
+    setCurrentIndex(row);
 
-  if (changeNum != currentIndex())
-    setCurrentIndex(changeNum);
+    updating_ = false;
+  }
 }
 
 void
 CQDiffCombo::
 load()
 {
-  QComboBox::clear();
+  updating_ = true;
 
-  for (const auto &change : diff_->getChanges()) {
-    std::string str = CStrUtil::strprintf("%d: %s", change.getNum(), change.getString().c_str());
+  model_->load();
 
-    addItem(str.c_str());
-  }
+  updating_ = false;
+
+  updateChangeSlot();
+}
+
+void
+CQDiffCombo::
+append()
+{
+  updating_ = true;
+
+  model_->append();
+
+  updating_ = false;
+
+  updateChangeSlot();
+}
+
+void
+CQDiffCombo::
+filterSlot(const QString &filter)
+{
+  updating_ = true;
+
+  model_->setFilter(filter);
+
+  updating_ = false;
+
+  updateChangeSlot();
+}
+
+void
+CQDiffCombo::
+selectFirstSlot()
+{
+  int ind = model_->rowChange(0);
+
+  if (ind >= 0)
+    diff_->setChangeNum(ind);
 }
 
 //-------
@@ -890,25 +2796,133 @@ paintEvent(QPaintEvent *e)
   int us = ulrect.height();
   int ds = dlrect.height();
 
+  int sheight = height() - us - ds;
+  int swidth  = width() - 2*sm;
+
+  if (sheight <= 0 || swidth <= 0)
+    return;
+
+  updateImage(swidth, sheight);
+
   QPainter painter(this);
 
+  painter.drawImage(sm, us, image_);
+}
+
+// draw changes into image if changed. Display rows are binned per (device) pixel row
+// and each pixel row is drawn in the color of the change type covering most rows with
+// the opacity of the fraction of rows covered.
+void
+CQDiffBar::
+updateImage(int width, int height)
+{
   CSideType side = CSIDE_TYPE_LEFT;
 
-  CQFileEdit *edit = diff_->getEdit(side);
+  BarState state;
 
-  int sheight = height() - us - ds;
-  int smax    = maximum() + pageStep();
+  state.width      = width;
+  state.height     = height;
+  state.pixelRatio = devicePixelRatioF();
+  state.changesId  = diff_->changesId();
+  state.add        = diff_->getChangeColor(side, 'a');
+  state.change     = diff_->getChangeColor(side, 'c');
+  state.del        = diff_->getChangeColor(side, 'd');
+
+  if (state == state_ && ! image_.isNull())
+    return;
+
+  state_ = state;
+
+  //---
+
+  int ih = int(height*state.pixelRatio);
+  int iw = int(width *state.pixelRatio);
+
+  image_ = QImage(iw, ih, QImage::Format_ARGB32_Premultiplied);
+
+  image_.setDevicePixelRatio(state.pixelRatio);
+
+  image_.fill(Qt::transparent);
+
+  const auto &rows = diff_->rows();
+
+  int numRows = rows.numRows();
+
+  if (numRows <= 0 || ih <= 0)
+    return;
+
+  // rows covered by each change type in each pixel row
+  enum { ADD, CHANGE, DEL, NUM_TYPES };
+
+  std::vector<double> binRows(size_t(ih)*NUM_TYPES, 0.0);
+
+  double binSize = (1.0*numRows)/ih; // rows per pixel row
+
+  const auto &changes = diff_->getChanges();
+
+  int numChanges = std::min(changes.size(), rows.numChanges());
+
+  for (int i = 0; i < numChanges; ++i) {
+    char c = changes.type(i);
+
+    int type = (c == 'a' ? ADD : c == 'c' ? CHANGE : DEL);
+
+    double r1 = rows.changeRow(i);
+    double r2 = r1 + rows.changeNumRows(i);
+
+    int b1 = std::min(int(r1/binSize), ih - 1);
+    int b2 = std::min(int(r2/binSize), ih - 1);
+
+    for (int b = b1; b <= b2; ++b) {
+      double overlap = std::min(r2, (b + 1)*binSize) - std::max(r1, b*binSize);
+
+      if (overlap > 0)
+        binRows[size_t(b)*NUM_TYPES + size_t(type)] += overlap;
+    }
+  }
+
+  //---
 
-  double scale = (smax > 0 ? (1.0*sheight)/smax : 1);
+  QColor colors[NUM_TYPES] = { state.add, state.change, state.del };
 
-  int w = width();
+  auto binRowSize = std::min(binSize, 1.0*numRows);
 
-  for (const auto &change : diff_->getChanges()) {
-    double y1 = scale*(us + change.getOffset(side));
-    double y2 = y1 + scale*change.getMaxLen()*edit->charHeight();
+  for (int b = 0; b < ih; ++b) {
+    const double *bin = &binRows[size_t(b)*NUM_TYPES];
 
-    QColor c = diff_->getChangeColor(side, change.getChar());
+    int    type    = ADD;
+    double covered = 0.0;
 
-    painter.fillRect(QRectF(QPointF(sm, y1), QSizeF(w - 2*sm, y2 - y1 + 1)), c);
+    for (int t = 0; t < NUM_TYPES; ++t) {
+      if (bin[t] > bin[type])
+        type = t;
+
+      covered += bin[t];
+    }
+
+    if (covered <= 0.0)
+      continue;
+
+    // keep single line changes visible in large files
+    double density = std::min(covered/binRowSize, 1.0);
+
+    QColor c = colors[type];
+
+    c.setAlphaF(c.alphaF()*(0.4 + 0.6*density));
+
+    QRgb rgb = qPremultiply(c.rgba());
+
+    auto *line = reinterpret_cast<QRgb *>(image_.scanLine(b));
+
+    std::fill(line, line + iw, rgb);
   }
 }
+
+void
+CQDiffBar::
+resizeEvent(QResizeEvent *e)
+{
+  QScrollBar::resizeEvent(e);
+
+  diff_->updateDataHeight();
+}
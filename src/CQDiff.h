@@ -3,12 +3,24 @@
 
 #include <CSideType.h>
 #include <CQMainWindow.h>
-
+#include <CDiffEngine.h>
+#include <CDiffLines.h>
+#include <CDiffChanges.h>
+#include <CDiffRows.h>
+#include <CDiffMoves.h>
+#include <CDiffInline.h>
+#include <CQGlyphAtlas.h>
+#include <CQTileCache.h>
+
+#include <QAbstractListModel>
 #include <QComboBox>
 #include <QScrollBar>
 #include <map>
+#include <memory>
+#include <thread>
 #include <cassert>
 
+class CDiffThreadPool;
 class CQDiff;
 class CQFileEdit;
 class CQFileEditCanvas;
@@ -20,9 +32,13 @@ class CQToolBar;
 class QScrollBar;
 class QPainter;
 class QLabel;
+class QLineEdit;
+class QTimer;
+class QFileSystemWatcher;
 
 //------
 
+// Values of a change (copied from change table)
 class CQDiffChange {
  public:
   CQDiffChange(uint num=0, char c=0, int lstart=0, int lend=0, int rstart=0, int rend=0) :
@@ -57,31 +73,69 @@ class CQDiffChange {
     return std::max(llen_, rlen_);
   }
 
-  void setString(const std::string &str) { str_ = str; }
-
-  const std::string &getString() const { return str_; }
+  // index of change at other end of (first) moved block in change (-1 if none)
+  int getMoveChange() const { return moveChange_; }
+  void setMoveChange(int i) { moveChange_ = i; }
 
-  void setOffset(CSideType side, int offset) {
-    if (side == CSIDE_TYPE_LEFT) loffset_ = offset;
-    else                         roffset_ = offset;
+  // diff normal format header
+  std::string getString() const {
+    return CDiffChanges::header(c_, lstart_, lend_, rstart_, rend_);
   }
 
-  int getOffset(CSideType side) const {
-    return (side == CSIDE_TYPE_LEFT ? loffset_ : roffset_);
-  }
+ private:
+  uint num_ { 0 };
+  char c_ { '\0' };
+  int  lstart_ { 0 }, lend_ { 0 }, llen_ { 0 };
+  int  rstart_ { 0 }, rend_ { 0 }, rlen_ { 0 };
+  int  moveChange_ { -1 };
+};
 
-  void resetOffset(CSideType side) {
-    if (side == CSIDE_TYPE_LEFT) loffset_ = -1;
-    else                         roffset_ = -1;
-  }
+//------
+
+// List of changes (optionally filtered). Rows are only formatted when displayed so no
+// per change items are created.
+class CQDiffChangeModel : public QAbstractListModel {
+  Q_OBJECT
+
+ public:
+  CQDiffChangeModel(CQDiff *diff, QObject *parent=nullptr);
+
+  int rowCount(const QModelIndex &parent=QModelIndex()) const override;
+
+  QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const override;
+
+  // filter changes by hunk type characters (a, c, d), moved blocks (m) and/or a line
+  // number in either file
+  const QString &filter() const { return filter_; }
+  void setFilter(const QString &filter);
+
+  // reload all changes
+  void load();
+
+  // add changes added since last load/append
+  void append();
+
+  // change index of row (-1 if none)
+  int rowChange(int row) const;
+
+  // row of change index (-1 if filtered out)
+  int changeRow(int ind) const;
+
+ private:
+  bool isFiltered() const { return (! types_.empty() || moved_ || line_ >= 0); }
+
+  bool acceptChange(int ind) const;
 
  private:
-  uint        num_ { 0 };
-  char        c_ { '\0' };
-  int         lstart_ { 0 }, lend_ { 0 }, llen_ { 0 };
-  int         rstart_ { 0 }, rend_ { 0 }, rlen_ { 0 };
-  std::string str_;
-  int         loffset_ { -1 }, roffset_ { -1 };
+  using Inds = std::vector<int>;
+
+  CQDiff      *diff_       { nullptr };
+  QString     filter_;
+  std::string types_;               // accepted hunk types (all if empty)
+  bool        moved_      { false }; // only changes with moved blocks
+  int         line_       { -1 };    // line in change (any if -1)
+  int         numChanges_ { 0 };     // changes added to model
+  Inds        inds_;                 // change indices of rows when filtered
 };
 
 //------
@@ -94,12 +148,24 @@ class CQDiffCombo : public QComboBox {
 
   void load();
 
+  // add items for changes added since last load/append
+  void append();
+
+ public slots:
+  // type ahead filter of listed changes
+  void filterSlot(const QString &filter);
+
+  // select first listed change
+  void selectFirstSlot();
+
  private slots:
   void changedSlot(int);
   void updateChangeSlot();
 
  private:
-  CQDiff *diff_ { nullptr };
+  CQDiff            *diff_     { nullptr };
+  CQDiffChangeModel *model_    { nullptr };
+  bool               updating_ { false };
 };
 
 //------
@@ -112,8 +178,30 @@ class CQDiffBar : public QScrollBar {
 
   void paintEvent(QPaintEvent *) override;
 
+  void resizeEvent(QResizeEvent *) override;
+
  private:
-  CQDiff *diff_ { nullptr };
+  // everything drawn in the overview image
+  struct BarState {
+    int    width      { 0 };
+    int    height     { 0 };
+    double pixelRatio { 1.0 };
+    uint   changesId  { 0 };
+    QColor add, change, del;
+
+    bool operator==(const BarState &rhs) const {
+      return (width     == rhs.width     && height == rhs.height && pixelRatio == rhs.pixelRatio &&
+              changesId == rhs.changesId && add    == rhs.add    && change     == rhs.change     &&
+              del       == rhs.del);
+    }
+  };
+
+  void updateImage(int width, int height);
+
+ private:
+  CQDiff  *diff_ { nullptr };
+  BarState state_;
+  QImage   image_;
 };
 
 //------
@@ -139,24 +227,19 @@ class CQFileEdit : public QWidget {
   Q_PROPERTY(QString filename    READ getFileName   WRITE setFileName)
   Q_PROPERTY(bool    showNumbers READ isShowNumbers WRITE setShowNumbers)
 
- public:
-  struct Change {
-    uint num { 0 };
-    char c { '\0' };
-    int  start { 0 }, end { 0 };
-
-    Change(uint num1=0, char c1=0, int start1=0, int end1=0) :
-     num(num1), c(c1), start(start1), end(end1) {
-    }
-  };
-
  public:
   CQFileEdit(CQDiff *diff, CSideType side, const QString &fileName="");
 
   void setFileName(const QString &fileName);
   const QString &getFileName() const { return fileName_; }
 
-  void addChange(uint num, char c, int start, int end);
+  typedef CDiffLines::Ids LineIds;
+
+  const LineIds &getLineIds() const;
+
+  int numLines() const;
+
+  std::string_view getLine(int i) const;
 
   bool isShowNumbers() const { return showNumbers_; }
   void setShowNumbers(bool b) { showNumbers_ = b; }
@@ -165,9 +248,35 @@ class CQFileEdit : public QWidget {
   int charHeight() const { return charHeight_; }
   int charAscent() const { return charAscent_; }
 
-  void reset();
+  // update char size from canvas font
+  void updateCharSize();
+
+  // draw rect of canvas from cached row tiles
+  void draw(QPainter *p, const QRect &rect);
+
+  // draw text starting at column col with column 0 at x and top of row at y
+  void drawText(QPainter *p, int x, int y, const std::string_view &str, int col=0) const;
+
+  // draw columns of line visible in width with column 0 at x and top of row at y
+  void drawLine(QPainter *p, int x, int y, int line, int width) const;
+
+  // update font, colors, etc used to draw tiles (returns false if tiles were cleared)
+  bool prepareDraw();
 
-  void draw(QPainter *p);
+  QRect canvasRect() const;
+
+  void tileRange(const QRect &rect, int &ind1, int &ind2) const;
+
+  bool hasTile(int ind) const;
+
+  QImage drawTile(int ind) const;
+
+  void addTile(int ind, const QImage &image);
+
+  // remove cached tiles of rows (to be redrawn)
+  void invalidateRows(int row1, int row2);
+
+  QWidget *canvas() const;
 
   void updateScrollbars(int height);
 
@@ -178,13 +287,45 @@ class CQFileEdit : public QWidget {
   void vscrollSlot(int y);
 
  private:
-  typedef std::map<int, Change> ChangeMap;
+  // everything drawn in a tile except the rows
+  struct TileState {
+    QFont  font;
+    double pixelRatio  { 1.0 };
+    int    width       { 0 };
+    int    xOffset     { 0 };
+    bool   showNumbers { true };
+    int    changeNum   { -1 };
+    uint   resultId    { 0 };
+    uint   inlineId    { 0 };
+    QColor bg, fg, border, add, change, del, move, selected;
+
+    bool operator==(const TileState &rhs) const {
+      return (font        == rhs.font        && pixelRatio == rhs.pixelRatio &&
+              width       == rhs.width       && xOffset    == rhs.xOffset    &&
+              showNumbers == rhs.showNumbers && changeNum  == rhs.changeNum  &&
+              resultId    == rhs.resultId    && inlineId   == rhs.inlineId   &&
+              bg          == rhs.bg          &&
+              fg          == rhs.fg          && border     == rhs.border     &&
+              add         == rhs.add         && change     == rhs.change     &&
+              del         == rhs.del         && move       == rhs.move       &&
+              selected    == rhs.selected);
+    }
+  };
+
+  static int tileRows() { return 64; }
+
+  bool updateTileState();
+
+  void drawRows(QPainter *p, int startRow, int endRow, int y, int width, int height) const;
 
+  // fill changed spans of line with column 0 at x
+  void drawInlineSpans(QPainter *p, int x, int y, int change, int line,
+                       const QColor &c) const;
+
+ private:
   CQDiff                   *diff_        { nullptr };
   CSideType                 side_        { CSIDE_TYPE_LEFT };
   QString                   fileName_;
-  std::vector<std::string>  lines_;
-  ChangeMap                 changeMap_;
   int                       x_offset_    { 0 };
   int                       y_offset_    { 0 };
   CQFileEditCanvas         *canvas_      { nullptr };
@@ -194,6 +335,9 @@ class CQFileEdit : public QWidget {
   int                       charWidth_   { 0 };
   int                       charHeight_  { 0 };
   int                       charAscent_  { 0 };
+  CQGlyphAtlas              atlas_;
+  CQTileCache               tiles_;
+  TileState                 tileState_;
 };
 
 //------
@@ -210,10 +354,15 @@ class CQDiff : public CQMainWindow {
   Q_PROPERTY(QColor rightAddColor    READ rightAddColor    WRITE setRightAddColor)
   Q_PROPERTY(QColor rightChangeColor READ rightChangeColor WRITE setRightChangeColor)
   Q_PROPERTY(QColor rightDeleteColor READ rightDeleteColor WRITE setRightDeleteColor)
+  Q_PROPERTY(QColor leftMoveColor    READ leftMoveColor    WRITE setLeftMoveColor)
+  Q_PROPERTY(QColor rightMoveColor   READ rightMoveColor   WRITE setRightMoveColor)
   Q_PROPERTY(QColor selectedColor    READ selectedColor    WRITE setSelectedColor)
 
+  Q_PROPERTY(int linearSpaceLines READ linearSpaceLines WRITE setLinearSpaceLines)
+  Q_PROPERTY(int tileCacheSize    READ tileCacheSize    WRITE setTileCacheSize   )
+
  public:
-  typedef std::vector<CQDiffChange> ChangeArray;
+  typedef CDiffEngine::Algorithm    Algorithm;
 
  public:
   CQDiff();
@@ -246,6 +395,12 @@ class CQDiff : public CQMainWindow {
   const QColor &rightDeleteColor() const { return rightDeleteColor_; }
   void setRightDeleteColor(const QColor &v) { rightDeleteColor_ = v; }
 
+  const QColor &leftMoveColor() const { return leftMoveColor_; }
+  void setLeftMoveColor(const QColor &v) { leftMoveColor_ = v; }
+
+  const QColor &rightMoveColor() const { return rightMoveColor_; }
+  void setRightMoveColor(const QColor &v) { rightMoveColor_ = v; }
+
   const QColor &selectedColor() const { return selectedColor_; }
   void setSelectedColor(const QColor &v) { selectedColor_ = v; }
 
@@ -258,6 +413,10 @@ class CQDiff : public CQMainWindow {
 
   bool parseChange(const std::string &line);
 
+  static bool parseHunk(const std::string &line, CDiffEngine::Hunk &hunk);
+
+  void addChange(char c, int lstart, int lend, int rstart, int rend);
+
   QWidget *createCentralWidget() override;
 
   void createMenus() override;
@@ -266,33 +425,113 @@ class CQDiff : public CQMainWindow {
 
   void scrollToChange(int change);
 
-  void setDataHeight(int dataHeight);
+  // update scroll range from display rows
+  void updateDataHeight();
+
+  // draw missing tiles of edit (and visible tiles of other edit) in parallel
+  void drawTiles(CQFileEdit *edit, int ind1, int ind2);
 
   CQFileEdit *getEdit(CSideType side) const {
     return (side == CSIDE_TYPE_LEFT ? ledit_ : redit_);
   }
 
-  const ChangeArray &getChanges() const { return changes_; }
+  const CDiffLines &lines() const { return *lines_; }
+
+  // aligned display rows of changes
+  const CDiffRows &rows() const { return rows_; }
 
-  int getNumChanges() const { return int(changes_.size()); }
+  // shared change table
+  const CDiffChanges &getChanges() const { return changes_; }
+
+  int getNumChanges() const { return changes_.size(); }
 
   int  getChangeNum() const { return changeNum_; }
   void setChangeNum(int changeNum);
 
-  const CQDiffChange &getChange(int i) const {
-    assert(i >= 0 && i < int(changes_.size()));
+  CQDiffChange getChange(int i) const {
+    assert(i >= 0 && i < changes_.size());
 
-    return changes_[uint(i)];
-  }
+    CQDiffChange change(uint(i + 1), changes_.type(i),
+                        changes_.start(CSIDE_TYPE_LEFT , i), changes_.end(CSIDE_TYPE_LEFT , i),
+                        changes_.start(CSIDE_TYPE_RIGHT, i), changes_.end(CSIDE_TYPE_RIGHT, i));
 
-  CQDiffChange &getChange(int i) {
-    assert(i >= 0 && i < int(changes_.size()));
+    change.setMoveChange(moveChange(i));
 
-    return changes_[uint(i)];
+    return change;
   }
 
-  bool isIgnoreWhiteSpace() const { return ignoreWhiteSpace_; }
-  void setIgnoreWhiteSpace(bool b) { ignoreWhiteSpace_ = b; }
+  // moved blocks of changes (found after diff completes)
+  const CDiffMoves &getMoves() const { return moves_; }
+
+  // index of change at other end of (first) moved block in change (-1 if none)
+  int moveChange(int i) const;
+
+  bool isDetectMoves() const { return detectMoves_; }
+  void setDetectMoves(bool b) { detectMoves_ = b; }
+
+  // ignored line differences (CDiffEngine::IgnoreFlags)
+  uint ignoreFlags() const { return ignoreFlags_; }
+  void setIgnoreFlags(uint flags) { ignoreFlags_ = flags; }
+
+  bool isIgnoreFlag(uint flag) const { return (ignoreFlags_ & flag); }
+  void setIgnoreFlag(uint flag, bool b) {
+    ignoreFlags_ = (b ? ignoreFlags_ | flag : ignoreFlags_ & ~flag); }
+
+  bool isIgnoreWhiteSpace() const { return isIgnoreFlag(CDiffEngine::IGNORE_ALL_SPACE); }
+  void setIgnoreWhiteSpace(bool b) { setIgnoreFlag(CDiffEngine::IGNORE_ALL_SPACE, b); }
+
+  const Algorithm &algorithm() const { return algorithm_; }
+  void setAlgorithm(const Algorithm &a) { algorithm_ = a; }
+
+  bool isExternalDiff() const { return externalDiff_; }
+  void setExternalDiff(bool b) { externalDiff_ = b; }
+
+  // regex mask/ignore rules (CDiffMask text format) applied before ignore flags
+  const CDiffMask &mask() const { return *mask_; }
+  bool setMaskText(const std::string &text, std::string &msg);
+
+  // named mask rules (builtin and saved in settings)
+  QStringList maskPresetNames() const;
+  QString maskPresetText(const QString &name) const;
+  void saveMaskPreset(const QString &name, const QString &text);
+
+  // minimum lines for linear space myers diff
+  int linearSpaceLines() const { return linearSpaceLines_; }
+  void setLinearSpaceLines(int n) { linearSpaceLines_ = n; }
+
+  // maximum size (MB) of row tile cache of each file
+  int tileCacheSize() const { return tileCacheSize_; }
+  void setTileCacheSize(int n) { tileCacheSize_ = n; }
+
+  // reload and diff changed lines when files are modified
+  bool isAutoReload() const { return autoReload_; }
+  void setAutoReload(bool b);
+
+  // delay (ms) after last file modification before reload
+  static int reloadDelay() { return 500; }
+
+  // id of current diff result (changes when result is replaced, tiles of streamed
+  // changes are invalidated by row)
+  uint resultId() const { return resultId_; }
+
+  // id of change list (changes when changes are added or replaced)
+  uint changesId() const { return changesId_; }
+
+  // intra line (word or char) diff of lines of changed hunks
+  bool isInlineDiff() const { return inlineDiff_; }
+  void setInlineDiff(bool b);
+
+  const CDiffInline::Mode &inlineMode() const { return inlineMode_; }
+  void setInlineMode(const CDiffInline::Mode &mode);
+
+  // id of inline diff settings (changes when inline diffs are cleared)
+  uint inlineId() const { return inlineId_; }
+
+  // start background inline diff of changes in rows which aren't diffed yet
+  void requestInlineDiffs(int row1, int row2);
+
+  // changed spans of line in change (nullptr if not diffed)
+  const CDiffInline::Spans *inlineSpans(CSideType side, int change, int line) const;
 
   QColor getChangeColor(CSideType side, char c) const {
     if (side == CSIDE_TYPE_LEFT) {
@@ -300,6 +539,7 @@ class CQDiff : public CQMainWindow {
         case 'a': return leftAddColor();
         case 'c': return leftChangeColor();
         case 'd': return leftDeleteColor();
+        case 'm': return leftMoveColor();
         default : return bgColor();
       }
     }
@@ -308,6 +548,7 @@ class CQDiff : public CQMainWindow {
         case 'a': return rightAddColor();
         case 'c': return rightChangeColor();
         case 'd': return rightDeleteColor();
+        case 'm': return rightMoveColor();
         default : return bgColor();
       }
     }
@@ -325,17 +566,117 @@ class CQDiff : public CQMainWindow {
   void lastDiffSlot();
   void prevDiffSlot();
   void nextDiffSlot();
+  void moveDiffSlot();
 
   void recomputeSlot();
+  void autoReloadSlot(bool);
+  void fileChangedSlot(const QString &);
+  void reloadSlot();
+  void cancelSlot();
+
+  void progressSlot();
 
   void whiteSpaceSlot(bool);
+  void spaceChangeSlot(bool);
+  void trailingSpaceSlot(bool);
+  void ignoreCaseSlot(bool);
+  void ignoreCRSlot(bool);
+  void myersSlot();
+  void patienceSlot();
+  void histogramSlot();
+  void externalDiffSlot(bool);
+  void detectMovesSlot(bool);
   void showLineNumbersSlot(bool);
+  void inlineDiffSlot(bool);
+  void inlineCharSlot(bool);
+
+  void editMaskSlot();
+  void loadMaskPresetSlot();
+  void saveMaskPresetSlot();
 
   void aboutSlot();
 
   void scrollToChange();
 
  private:
+  struct DiffJob;
+
+  typedef std::shared_ptr<DiffJob>         DiffJobP;
+  typedef std::shared_ptr<CDiffLines>      LinesP;
+  typedef std::shared_ptr<CDiffMask>       MaskP;
+  typedef std::unique_ptr<CDiffThreadPool> ThreadPoolP;
+
+  // changed spans of each line pair of a change
+  struct InlineDiff {
+    std::vector<CDiffInline::Spans> lspans;
+    std::vector<CDiffInline::Spans> rspans;
+  };
+
+  typedef std::shared_ptr<InlineDiff>  InlineDiffP;
+  typedef std::map<int, InlineDiffP>   InlineDiffs; // null if being diffed
+  typedef std::pair<int, InlineDiffP>  ChangeInlineDiff;
+  typedef std::vector<ChangeInlineDiff> ChangeInlineDiffs;
+
+  struct InlineWorker;
+
+  typedef std::unique_ptr<InlineWorker> InlineWorkerP;
+
+  void clearInlineDiffs();
+
+  void inlineWorkerLoop();
+
+  void inlineDiffsFinished(uint generation, const ChangeInlineDiffs &diffs);
+
+  // maximum line pairs of change diffed
+  static int maxInlinePairs() { return 1000; }
+
+  // settings of complete diff result (auto reload only diffs changed lines if the
+  // settings are unchanged)
+  struct ResultState {
+    bool      complete    { false };
+    Algorithm algorithm   { Algorithm::MYERS };
+    uint      ignoreFlags { CDiffEngine::IGNORE_NONE };
+    MaskP     mask;
+    bool      detectMoves { true };
+  };
+
+  // running (or finished but not joined) job and its thread
+  struct JobThread {
+    DiffJobP    job;
+    std::thread thread;
+  };
+
+  typedef std::vector<JobThread> JobThreads;
+
+  void startJob(bool reload, bool incremental=false, bool movesOnly=false);
+  void jobFinished(const DiffJobP &job);
+
+  void updateMoves();
+
+  void joinJobThreads();
+
+  void beginJobResult(DiffJob &job);
+  void applyJobHunks(DiffJob &job);
+
+  static void addJobHunks(DiffJob &job, const CDiffEngine::Hunks &hunks);
+
+  static void execJob        (DiffJob &job);
+  static bool execInternal   (DiffJob &job);
+  static bool execIncremental(DiffJob &job);
+  static bool execExternal   (DiffJob &job);
+  static bool execMoves      (DiffJob &job);
+
+  static bool initEngine(DiffJob &job, CDiffEngine &engine);
+
+  // watch files for auto reload (returns false if a file doesn't exist)
+  bool watchFiles();
+
+  void updateDiffItems();
+
+  void updateMaskItems();
+
+  void updateAlgorithm(const Algorithm &algorithm);
+
   void updateVBar();
 
  private:
@@ -348,6 +689,8 @@ class CQDiff : public CQMainWindow {
   QColor       rightAddColor_       { 255, 100, 100 };
   QColor       rightChangeColor_    { 100, 255, 100 };
   QColor       rightDeleteColor_    { 100, 100, 255 };
+  QColor       leftMoveColor_       { 230, 190, 255 };
+  QColor       rightMoveColor_      { 210, 160, 255 };
   QColor       selectedColor_       { 240, 230, 140 };
   QWidget     *frame_               { nullptr };
   QLabel      *llabel_              { nullptr };
@@ -361,20 +704,66 @@ class CQDiff : public CQMainWindow {
   CQMenuItem  *lastDiffItem_        { nullptr };
   CQMenuItem  *nextDiffItem_        { nullptr };
   CQMenuItem  *prevDiffItem_        { nullptr };
+  CQMenuItem  *moveDiffItem_        { nullptr };
   CQMenuItem  *whiteSpaceItem_      { nullptr };
+  CQMenuItem  *spaceChangeItem_     { nullptr };
+  CQMenuItem  *trailingSpaceItem_   { nullptr };
+  CQMenuItem  *ignoreCaseItem_      { nullptr };
+  CQMenuItem  *ignoreCRItem_        { nullptr };
+  CQMenuItem  *editMaskItem_        { nullptr };
+  CQMenuItem  *loadMaskItem_        { nullptr };
+  CQMenuItem  *saveMaskItem_        { nullptr };
+  CQMenuItem  *myersItem_           { nullptr };
+  CQMenuItem  *patienceItem_        { nullptr };
+  CQMenuItem  *histogramItem_       { nullptr };
+  CQMenuItem  *externalDiffItem_    { nullptr };
+  CQMenuItem  *detectMovesItem_     { nullptr };
   CQMenuItem  *recompItem_          { nullptr };
+  CQMenuItem  *cancelItem_          { nullptr };
   CQMenuItem  *showLineNumbersItem_ { nullptr };
+  CQMenuItem  *inlineDiffItem_      { nullptr };
+  CQMenuItem  *inlineCharItem_      { nullptr };
+  CQMenuItem  *autoReloadItem_      { nullptr };
   CQMenu      *viewMenu_            { nullptr };
   CQMenu      *helpMenu_            { nullptr };
   CQToolBar   *diffToolBar_         { nullptr };
   CQDiffCombo *diffCombo_           { nullptr };
+  QLineEdit   *diffFilter_          { nullptr };
   QLabel      *lslabel_             { nullptr };
   QLabel      *rslabel_             { nullptr };
-  ChangeArray  changes_;
+  LinesP       lines_;
+  CDiffRows    rows_;
+  DiffJobP     job_;
+  JobThreads   jobThreads_;
+  uint         generation_          { 0 };
+  QTimer      *progressTimer_       { nullptr };
+  ResultState  resultState_;
+  CDiffChanges changes_;
+  CDiffMoves   moves_;
+  bool         detectMoves_         { true };
   int          changeNum_           { 0 };
   int          dataHeight_          { 0 };
   int          scrollHeight_        { 0 };
-  bool         ignoreWhiteSpace_    { false };
+  uint         ignoreFlags_         { CDiffEngine::IGNORE_NONE };
+  MaskP        mask_;
+  bool         externalDiff_        { false };
+  Algorithm    algorithm_           { Algorithm::MYERS };
+  int          linearSpaceLines_    { 10000 };
+  int          tileCacheSize_       { 64 };
+  ThreadPoolP  renderPool_;         // draws tiles
+  uint         resultId_            { 0 };
+  uint         changesId_           { 0 };
+
+  bool              inlineDiff_       { true };
+  CDiffInline::Mode inlineMode_       { CDiffInline::Mode::WORD };
+  InlineDiffs       inlineDiffs_;
+  uint              inlineGeneration_ { 0 };
+  uint              inlineId_         { 0 };
+  InlineWorkerP     inlineWorker_;     // started by first request
+
+  bool                autoReload_  { false };
+  QTimer             *reloadTimer_ { nullptr };
+  QFileSystemWatcher *watcher_     { nullptr };
 };
 
 #endif
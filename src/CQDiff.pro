@@ -18,9 +18,39 @@ MOC_DIR = .moc
 SOURCES += \
 main.cpp \
 CQDiff.cpp \
+CQGlyphAtlas.cpp \
+CQTileCache.cpp \
+CDiffEngine.cpp \
+CDiffLineTable.cpp \
+CDiffLines.cpp \
+CDiffChanges.cpp \
+CDiffMask.cpp \
+CDiffMoves.cpp \
+CDiffInline.cpp \
+CDiffRows.cpp \
+CDiffFile.cpp \
+CDiffColumnIndex.cpp \
+CDiffThreadPool.cpp \
+CDiffSimd.cpp \
+CDiffBench.cpp \
 
 HEADERS += \
 CQDiff.h \
+CQGlyphAtlas.h \
+CQTileCache.h \
+CDiffEngine.h \
+CDiffLineTable.h \
+CDiffLines.h \
+CDiffChanges.h \
+CDiffMask.h \
+CDiffMoves.h \
+CDiffInline.h \
+CDiffRows.h \
+CDiffFile.h \
+CDiffColumnIndex.h \
+CDiffThreadPool.h \
+CDiffSimd.h \
+CDiffBench.h \
 
 DESTDIR     = ../bin
 OBJECTS_DIR = ../obj
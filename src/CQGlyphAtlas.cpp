@@ -0,0 +1,136 @@
+#include <CQGlyphAtlas.h>
+
+#include <QFontInfo>
+#include <QFontMetrics>
+#include <QImage>
+
+CQGlyphAtlas::
+CQGlyphAtlas()
+{
+}
+
+bool
+CQGlyphAtlas::
+update(const QFont &font, const QColor &color, double pixelRatio)
+{
+  if (! image_.isNull() && font == font_ && color == color_ && pixelRatio == pixelRatio_)
+    return valid_;
+
+  font_       = font;
+  color_      = color;
+  pixelRatio_ = pixelRatio;
+
+  //---
+
+  QFontMetrics fm(font_);
+
+  charWidth_  = fm.horizontalAdvance(QChar('M'));
+  charHeight_ = fm.height();
+
+  // all glyphs must have the same advance
+  valid_ = QFontInfo(font_).fixedPitch();
+
+  for (int c = firstChar; valid_ && c <= lastChar; ++c) {
+    if (fm.horizontalAdvance(QChar(c)) != charWidth_)
+      valid_ = false;
+  }
+
+  if (! valid_) {
+    image_ = QImage();
+    return false;
+  }
+
+  //---
+
+  // one cell per glyph (at device resolution)
+  int numChars = lastChar - firstChar + 1;
+
+  image_ = QImage(int(numChars*charWidth_*pixelRatio_), int(charHeight_*pixelRatio_),
+                  QImage::Format_ARGB32_Premultiplied);
+
+  image_.setDevicePixelRatio(pixelRatio_);
+
+  image_.fill(Qt::transparent);
+
+  QPainter painter(&image_);
+
+  painter.setFont(font_);
+  painter.setPen (color_);
+
+  for (int c = firstChar; c <= lastChar; ++c)
+    painter.drawText((c - firstChar)*charWidth_, fm.ascent(), QString(QChar(c)));
+
+  painter.end();
+
+  return true;
+}
+
+bool
+CQGlyphAtlas::
+drawText(QPainter *p, int x, int y, const std::string_view &str, int col) const
+{
+  if (! valid_ || ! isAscii(str))
+    return false;
+
+  // source is in device pixels
+  double cw = charWidth_*pixelRatio_;
+  double ch = charHeight_*pixelRatio_;
+
+  for (auto c : str) {
+    if (c == '\t') {
+      col = (col/tabWidth() + 1)*tabWidth();
+      continue;
+    }
+
+    if (c != ' ') {
+      QRectF target(x + col*charWidth_, y, charWidth_, charHeight_);
+      QRectF source((c - firstChar)*cw, 0, cw, ch);
+
+      p->drawImage(target, image_, source);
+    }
+
+    ++col;
+  }
+
+  return true;
+}
+
+bool
+CQGlyphAtlas::
+isAscii(const std::string_view &str)
+{
+  for (auto c : str) {
+    if ((c < firstChar || c > lastChar) && c != '\t')
+      return false;
+  }
+
+  return true;
+}
+
+std::string
+CQGlyphAtlas::
+expandTabs(const std::string_view &str, int col)
+{
+  std::string str1;
+
+  str1.reserve(str.size());
+
+  for (auto c : str) {
+    if (c == '\t') {
+      int col1 = (col/tabWidth() + 1)*tabWidth();
+
+      str1.append(size_t(col1 - col), ' ');
+
+      col = col1;
+    }
+    else {
+      str1 += c;
+
+      // utf-8 continuation bytes don't start a column
+      if ((c & 0xC0) != 0x80)
+        ++col;
+    }
+  }
+
+  return str1;
+}
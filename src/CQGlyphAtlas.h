@@ -0,0 +1,52 @@
+#ifndef CQGlyphAtlas_H
+#define CQGlyphAtlas_H
+
+#include <QFont>
+#include <QColor>
+#include <QPainter>
+#include <QImage>
+#include <string_view>
+
+// Printable ASCII glyphs of a monospace font rasterized once into an image, so text
+// can be drawn as glyph image blits instead of shaping each string. Tabs advance to
+// the next tab stop. Strings with other characters are not drawn and must use
+// QPainter::drawText. Drawing only reads the atlas so can be done from several
+// (non gui) threads painting to images.
+class CQGlyphAtlas {
+ public:
+  CQGlyphAtlas();
+
+  // rebuild atlas if font, color or pixel ratio changed (returns false if font is not
+  // monospace)
+  bool update(const QFont &font, const QColor &color, double pixelRatio);
+
+  bool isValid() const { return valid_; }
+
+  int charWidth() const { return charWidth_; }
+
+  // draw string starting at column col with column 0 at x and row top at y (returns
+  // false if string is not ascii)
+  bool drawText(QPainter *p, int x, int y, const std::string_view &str, int col=0) const;
+
+  // check if string only has printable ascii and tabs
+  static bool isAscii(const std::string_view &str);
+
+  // string starting at column col with tabs replaced by spaces up to next tab stop
+  static std::string expandTabs(const std::string_view &str, int col=0);
+
+  static int tabWidth() { return 8; }
+
+ private:
+  static const int firstChar = 32;
+  static const int lastChar  = 126;
+
+  QFont  font_;
+  QColor color_;
+  double pixelRatio_ { 1.0 };
+  bool   valid_      { false };
+  int    charWidth_  { 0 };
+  int    charHeight_ { 0 };
+  QImage image_;
+};
+
+#endif
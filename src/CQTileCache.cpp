@@ -0,0 +1,92 @@
+#include <CQTileCache.h>
+
+CQTileCache::
+CQTileCache()
+{
+}
+
+void
+CQTileCache::
+setMaxBytes(int64_t n)
+{
+  maxBytes_ = n;
+
+  evict();
+}
+
+void
+CQTileCache::
+clear()
+{
+  tiles_.clear();
+
+  bytes_ = 0;
+}
+
+bool
+CQTileCache::
+get(int ind, QPixmap &pixmap)
+{
+  auto p = tiles_.find(ind);
+
+  if (p == tiles_.end())
+    return false;
+
+  auto &tile = (*p).second;
+
+  tile.used = ++useCount_;
+
+  pixmap = tile.pixmap;
+
+  return true;
+}
+
+void
+CQTileCache::
+add(int ind, const QPixmap &pixmap)
+{
+  auto &tile = tiles_[ind];
+
+  bytes_ -= tile.bytes;
+
+  tile.pixmap = pixmap;
+  tile.bytes  = int64_t(pixmap.width())*pixmap.height()*4;
+  tile.used   = ++useCount_;
+
+  bytes_ += tile.bytes;
+
+  evict();
+}
+
+void
+CQTileCache::
+remove(int ind)
+{
+  auto p = tiles_.find(ind);
+
+  if (p == tiles_.end())
+    return;
+
+  bytes_ -= (*p).second.bytes;
+
+  tiles_.erase(p);
+}
+
+// remove least recently used tiles until under limit (keeps at least one tile)
+void
+CQTileCache::
+evict()
+{
+  while (bytes_ > maxBytes_ && tiles_.size() > 1) {
+    auto lru = tiles_.begin();
+
+    for (auto p = tiles_.begin(); p != tiles_.end(); ++p) {
+      if ((*p).second.used < (*lru).second.used)
+        lru = p;
+    }
+
+    bytes_ -= (*lru).second.bytes;
+
+    tiles_.erase(lru);
+  }
+}
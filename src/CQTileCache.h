@@ -0,0 +1,52 @@
+#ifndef CQTileCache_H
+#define CQTileCache_H
+
+#include <QPixmap>
+#include <map>
+#include <cstdint>
+
+// Cache of rendered tiles (pixmaps) by tile index. The least recently used tiles are
+// removed when the total tile size exceeds the maximum.
+class CQTileCache {
+ public:
+  CQTileCache();
+
+  int64_t maxBytes() const { return maxBytes_; }
+  void setMaxBytes(int64_t n);
+
+  int64_t bytes() const { return bytes_; }
+
+  int numTiles() const { return int(tiles_.size()); }
+
+  void clear();
+
+  bool contains(int ind) const { return tiles_.find(ind) != tiles_.end(); }
+
+  // get tile (returns false if not cached)
+  bool get(int ind, QPixmap &pixmap);
+
+  // add tile (replaces existing)
+  void add(int ind, const QPixmap &pixmap);
+
+  // remove tile (if cached)
+  void remove(int ind);
+
+ private:
+  void evict();
+
+ private:
+  struct Tile {
+    QPixmap  pixmap;
+    int64_t  bytes { 0 };
+    uint64_t used  { 0 }; // use count at last access
+  };
+
+  using Tiles = std::map<int, Tile>;
+
+  Tiles    tiles_;
+  int64_t  bytes_    { 0 };
+  int64_t  maxBytes_ { 64*1024*1024 };
+  uint64_t useCount_ { 0 };
+};
+
+#endif
@@ -1,14 +1,32 @@
 #include <CQDiff.h>
+#include <CDiffBench.h>
+#include <CDiffThreadPool.h>
 #include <CQApp.h>
 #include <iostream>
 
 int
 main(int argc, char **argv)
 {
+  // time diff engine without gui
+  if (argc == 4 && std::string(argv[1]) == "-bench") {
+    CDiffBench bench;
+
+    if (! bench.load(argv[2], argv[3]))
+      exit(1);
+
+    bench.execLoad(CDiffThreadPool::defaultNumThreads());
+
+    bench.execThreads(CDiffThreadPool::defaultNumThreads());
+
+    bench.execLinearSpace();
+
+    return 0;
+  }
+
   CQApp app(argc, argv);
 
   if (argc != 3) {
-    std::cerr << "Usage:: CQDiff <file1> <file2>" << std::endl;
+    std::cerr << "Usage:: CQDiff [-bench] <file1> <file2>" << std::endl;
     exit(1);
   }
 
@@ -22,5 +40,8 @@ main(int argc, char **argv)
 
   app.exec();
 
+  // stop worker threads before the application is destroyed
+  delete diff;
+
   return 0;
 }